@@ -1,3 +1,12 @@
+#include <algorithm>
+#include <cstdio>
+
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <TFileMerger.h>
+
 #include "SuperManager.h"
 #undef MAXPM
 #undef MAXPMA
@@ -9,9 +18,95 @@
 #include "Printer.hh"
 #include "Store.hh"
 #include "SKIO.hh"
-//#include "TriggerManager.hh"
+#include "OutputCapture.hh"
+#include "TriggerManager.hh"
 #include "git.h"
 
+// output path of a shard, keeping the extension that sets the file format
+static std::string GetShardPath(std::string outputFilePath, int iShard)
+{
+    auto extensionPos = outputFilePath.rfind('.');
+    if (extensionPos == std::string::npos || outputFilePath.find('/', extensionPos) != std::string::npos)
+        extensionPos = outputFilePath.size();
+    return outputFilePath.substr(0, extensionPos) + Form(".shard%d", iShard) + outputFilePath.substr(extensionPos);
+}
+
+// runs AddNoise on event ranges in nShards child processes and merges their ROOT outputs in order
+static int RunShards(int argc, char **argv, Store& settings, int nShards)
+{
+    Printer msg("AddNoise");
+    auto outputFilePath = settings.GetString("out");
+
+    // ZEBRA files cannot be merged by concatenating them
+    if (!TString(outputFilePath).EndsWith(".root"))
+        msg.Print("Option -nshards needs a ROOT output (.root), use -shard i/N for other formats!", pERROR);
+
+    // all shards must share one base seed
+    int noiseSeed = settings.GetInt("NOISESEED");
+    if (!noiseSeed) {
+        ranGen.SetSeed(0);
+        noiseSeed = 1 + ranGen.Integer(2147483646);
+    }
+    msg.Print(Form("Running %d shards with noise seed %d...", nShards, noiseSeed));
+
+    std::vector<std::string> shardPaths;
+    std::vector<pid_t> shardPIDs;
+    for (int iShard=0; iShard<nShards; iShard++) {
+        shardPaths.push_back(GetShardPath(outputFilePath, iShard));
+
+        // later arguments override earlier ones
+        std::vector<std::string> args(argv, argv+argc);
+        std::vector<std::string> shardArgs = {"-nshards", "1", "-shard", Form("%d/%d", iShard, nShards),
+                                              "-out", shardPaths.back(), "-NOISESEED", std::to_string(noiseSeed),
+                                              "-noise_event_seed", "true"};
+        args.insert(args.end(), shardArgs.begin(), shardArgs.end());
+        std::vector<char*> cArgs;
+        for (auto& arg: args) cArgs.push_back(&arg[0]);
+        cArgs.push_back(nullptr);
+
+        std::cout.flush();
+        pid_t pid = fork();
+        if (pid == 0) {
+            execv("/proc/self/exe", cArgs.data());
+            _exit(127);
+        }
+        else if (pid < 0) {
+            // stop and reap the shards already started before exiting
+            for (auto const& startedPID: shardPIDs) {
+                kill(startedPID, SIGTERM);
+                waitpid(startedPID, nullptr, 0);
+            }
+            msg.Print(Form("Could not start shard %d!", iShard), pERROR);
+        }
+        shardPIDs.push_back(pid);
+    }
+
+    bool isGood = true;
+    for (auto const& pid: shardPIDs) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        isGood &= WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+    if (!isGood)
+        msg.Print("One or more shards failed, keeping shard outputs...", pERROR);
+
+    // merge shard outputs in event order
+    TFileMerger merger(false);
+    merger.OutputFile(outputFilePath.c_str(), "RECREATE");
+    for (auto const& shardPath: shardPaths)
+        merger.AddFile(shardPath.c_str());
+    if (!merger.Merge())
+        msg.Print("Failed merging shard outputs, keeping shard outputs...", pERROR);
+
+    for (auto const& shardPath: shardPaths)
+        remove(shardPath.c_str());
+
+    msg.Print(Form("Noise addition done!"));
+    msg.Print(Form("Output: %s", outputFilePath.c_str()));
+
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
     ArgParser parser(argc, argv);
@@ -26,6 +121,21 @@ int main(int argc, char **argv)
     auto inputFilePath = settings.GetString("in");
     auto outputFilePath = settings.GetString("out");
 
+    int nShards = settings.GetInt("nshards", 1);
+    if (nShards > 1)
+        return RunShards(argc, argv, settings, nShards);
+
+    // this process handles event range iShard of nShards
+    int iShard = 0; nShards = 1;
+    auto shard = settings.GetString("shard");
+    if (!shard.empty()) {
+        if (sscanf(shard.c_str(), "%d/%d", &iShard, &nShards) != 2 || iShard < 0 || iShard >= nShards)
+            msg.Print("Option -shard must be of the form i/N with 0 <= i < N!", pERROR);
+        if (!settings.GetInt("NOISESEED"))
+            msg.Print("Sharded runs need a fixed seed: set -NOISESEED to a nonzero value!", pERROR);
+        settings.Set("noise_event_seed", true);
+    }
+
     // Read input MC
     SKIO inputMC = SKIO(inputFilePath, mInput);
 
@@ -33,6 +143,7 @@ int main(int argc, char **argv)
     SKIO::SetSKOption("31,30");
     SKIO::SetSKBadChOption(0);
     SKIO::SetRefRunNo(settings.GetInt("REFRUNNO"));
+    OutputCapture::SetRingSize(1024*settings.GetInt("fortran_log"));
 
     inputMC.OpenFile();
     auto nInputEvents = inputMC.GetNumberOfEvents();
@@ -49,11 +160,25 @@ int main(int argc, char **argv)
     NoiseManager noiseManager;
     noiseManager.ApplySettings(settings, nInputEvents);
 
-    //TriggerManager trgManager(settings.GetInt("REFRUNNO"));
+    bool doReapplyTrigger = settings.GetBool("reapply_trigger", false);
+    bool doCheckTrigger = settings.GetBool("check_trigger", false);
+    TriggerManager trgManager(settings.GetInt("REFRUNNO"));
+    int nCheckedEvents = 0, nTriggerMismatches = 0, nCandidateMismatches = 0;
+    std::vector<SoftwareTrigger> softTriggers, nativeTriggers;
+    auto triggerOrder = [](const SoftwareTrigger& a, const SoftwareTrigger& b)
+                        { return a.t0 != b.t0 ? a.t0 < b.t0 : a.type < b.type; };
+    auto isSameTrigger = [](const SoftwareTrigger& a, const SoftwareTrigger& b)
+                         { return a.t0 == b.t0 && a.type == b.type; };
+
+    int firstEventID = 1 + (long)nInputEvents*iShard/nShards;
+    int lastEventID = (long)nInputEvents*(iShard+1)/nShards;
+    if (nShards > 1)
+        msg.Print(Form("Shard %d/%d: events %d to %d", iShard, nShards, firstEventID, lastEventID));
 
     // Event loop
-    for (int eventID=1; eventID<=nInputEvents; eventID++) {
+    for (int eventID=firstEventID; eventID<=lastEventID; eventID++) {
         msg.Print(Form("Processing event #%d...\x1b[A\r", eventID));
+        noiseManager.SetEventIndex(eventID-1);
 
         // Get input MC hits
         inputMC.ReadEvent(eventID);
@@ -71,11 +196,40 @@ int main(int argc, char **argv)
         auto& outputHits = inputMCIDHits;
 
         // Apply software trigger, if needed
-        //if (settings.GetBool("reapply_trigger", false)) {
-        //    trgManager.ApplyTrigger(inputMCIDHits);
-        //    //outputMC.FillHEADER(softwareTrg);
-        //    //outputMC.FillMCINFO(softwareTrg);
-        //}
+        if (doReapplyTrigger) {
+            // compare with softtrg_inittrgtbl_
+            if (doCheckTrigger) {
+                PMTHitCluster checkedHits = outputHits;
+                trgManager.ApplyTrigger(checkedHits);
+                int t0 = trgManager.GetT0(), triggerID = trgManager.GetTriggerID();
+                softTriggers = trgManager.GetTriggers();
+                trgManager.ApplyNativeTrigger(outputHits);
+                nativeTriggers = trgManager.GetTriggers();
+                if (t0 != trgManager.GetT0() || triggerID != trgManager.GetTriggerID()) {
+                    msg.Print(Form("Event #%d: native trigger (ID 0x%x, T0 %d) differs from softtrg (ID 0x%x, T0 %d)",
+                                   eventID, trgManager.GetTriggerID(), trgManager.GetT0(), triggerID, t0), pWARNING);
+                    nTriggerMismatches++;
+                }
+
+                // all trigger candidates, in the order of time and type
+                std::sort(softTriggers.begin(), softTriggers.end(), triggerOrder);
+                std::sort(nativeTriggers.begin(), nativeTriggers.end(), triggerOrder);
+                if (softTriggers.size() != nativeTriggers.size()
+                    || !std::equal(softTriggers.begin(), softTriggers.end(), nativeTriggers.begin(), isSameTrigger)) {
+                    msg.Print(Form("Event #%d: %lu native trigger candidates differ from %lu softtrg candidates",
+                                   eventID, nativeTriggers.size(), softTriggers.size()), pWARNING);
+                    for (auto const& trigger: softTriggers)
+                        msg.Print(Form("softtrg type %d T0 %d", trigger.type, trigger.t0), pDEBUG);
+                    for (auto const& trigger: nativeTriggers)
+                        msg.Print(Form("native  type %d T0 %d", trigger.type, trigger.t0), pDEBUG);
+                    nCandidateMismatches++;
+                }
+                nCheckedEvents++;
+            }
+            else
+                trgManager.ApplyNativeTrigger(outputHits);
+            trgManager.FillCommon();
+        }
 
         outputMC.FillTQREAL(outputHits);
         outputMC.Write();
@@ -85,6 +239,10 @@ int main(int argc, char **argv)
     outputMC.CloseFile();
 
     std::cout << "\n";
+    if (nCheckedEvents) {
+        msg.Print(Form("Native trigger differs from softtrg in %d of %d events", nTriggerMismatches, nCheckedEvents));
+        msg.Print(Form("Native trigger candidates differ from softtrg in %d of %d events", nCandidateMismatches, nCheckedEvents));
+    }
     msg.Print(Form("Noise addition done!"));
     msg.Print(Form("Output: %s", outputFilePath.c_str()));
 
@@ -0,0 +1,41 @@
+#include "ArgParser.hh"
+#include "Calculator.hh"
+#include "NoiseManager.hh"
+#include "Printer.hh"
+#include "Store.hh"
+#include "git.h"
+
+int main(int argc, char **argv)
+{
+    ArgParser parser(argc, argv);
+    Printer msg("MakeNoiseBank");
+    Store settings;
+
+    if (!GetENV("NTAGLIBPATH").empty())
+        settings.Initialize(GetENV("NTAGLIBPATH")+"/NTagConfig");
+    settings.ReadArguments(parser);
+    settings.Print();
+
+    auto inputNoise = settings.GetString("in");
+    auto outputFilePath = settings.GetString("out");
+
+    if (inputNoise.empty() || outputFilePath.empty())
+        msg.Print("Usage: MakeNoiseBank -in <noise ROOT file(s) or noise file list> -out <noise bank>", pERROR);
+
+    // the bank keeps the noise tree time frame, so noise range can be set when reading
+    NoiseManager noiseManager;
+    noiseManager.SetRandomizeFirstEntry(false);
+    if (TString(inputNoise).EndsWith(".root"))
+        noiseManager.SetNoiseTreeFromWildcard(inputNoise);
+    else
+        noiseManager.SetNoiseTreeFromList(inputNoise);
+
+    msg.Print(Form("Input noise: %s", inputNoise.c_str()));
+    msg.Print(Form("Output noise bank: %s", outputFilePath.c_str()));
+
+    noiseManager.DumpNoiseBank(outputFilePath);
+
+    msg.Print("Noise bank done!");
+
+    return 0;
+}
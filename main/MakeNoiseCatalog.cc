@@ -0,0 +1,40 @@
+#include "ArgParser.hh"
+#include "Calculator.hh"
+#include "NoiseManager.hh"
+#include "Printer.hh"
+#include "Store.hh"
+#include "git.h"
+
+int main(int argc, char **argv)
+{
+    ArgParser parser(argc, argv);
+    Printer msg("MakeNoiseCatalog");
+    Store settings;
+
+    if (!GetENV("NTAGLIBPATH").empty())
+        settings.Initialize(GetENV("NTAGLIBPATH")+"/NTagConfig");
+    settings.ReadArguments(parser);
+    settings.Print();
+
+    auto noisePath = settings.GetString("noise_path");
+    auto noiseType = settings.GetString("noise_type", "default");
+    auto outputFilePath = settings.GetString("out");
+
+    if (outputFilePath.empty())
+        msg.Print("Usage: MakeNoiseCatalog -noise_path <noise directory> -noise_type <sk4/sk5/sk6/...> -out <noise catalog>", pERROR);
+
+    NoiseManager noiseManager;
+    noiseManager.SetNoisePath(noisePath);
+    if (settings.HasKey("SKGEOMETRY"))
+        noiseManager.SetSKGeneration(settings.GetInt("SKGEOMETRY"));
+
+    msg.Print(Form("Noise path: %s", noisePath.c_str()));
+    msg.Print(Form("Noise type: %s", noiseType.c_str()));
+    msg.Print(Form("Output noise catalog: %s", outputFilePath.c_str()));
+
+    noiseManager.DumpNoiseCatalog(noiseType, outputFilePath, settings.GetBool("catalog_entries", false));
+
+    msg.Print("Noise catalog done!");
+
+    return 0;
+}
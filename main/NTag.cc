@@ -1,3 +1,5 @@
+#include <memory>
+
 #include "TFile.h"
 #include "TTree.h"
 
@@ -14,6 +16,7 @@
 #include "ArgParser.hh"
 #include "Printer.hh"
 #include "SKIO.hh"
+#include "OutputCapture.hh"
 #include "SKLibs.hh"
 #include "NoiseManager.hh"
 #include "EventNTagManager.hh"
@@ -91,6 +94,13 @@ int main(int argc, char** argv)
     SKIO::SetSKBadChOption(settings.GetInt("SKBADOPT"));
     SKIO::SetRefRunNo(settings.GetInt("REFRUNNO"));
 
+    // keep the latest suppressed library output (in kB) to dump on errors
+    OutputCapture::SetRingSize(1024*settings.GetInt("fortran_log"));
+
+    // console log settings
+    Logger::SetCategories(settings.GetString("log", "all"));
+    Logger::SetRateLimit(settings.GetFloat("log_rate"));
+
     if (parser.GetOption("-prompt_vertex")=="stmu") {
         input.AddSKOption(23);
         settings.Set("SKOPTN", input.GetSKOption());
@@ -117,15 +127,16 @@ int main(int argc, char** argv)
     ntagManager.DumpSettings();
 
     // read noise settings
-    NoiseManager* noiseManager = nullptr;
+    // owned here, so that its noise reader thread is stopped and joined on return
+    std::unique_ptr<NoiseManager> noiseManager;
     if (settings.GetBool("add_noise", false)) {
-        noiseManager = new NoiseManager;
+        noiseManager.reset(new NoiseManager);
         noiseManager->ApplySettings(settings, nInputEvents);
 
         // PMT deadtime will be covered in EventNTagManager,
         // so override PMT deadtime in noiseManager with zero for now
         noiseManager->SetPMTDeadtime(0);
-        ntagManager.SetNoiseManager(noiseManager);
+        ntagManager.SetNoiseManager(noiseManager.get());
     }
 
     // set output file and trees
@@ -143,9 +154,15 @@ int main(int argc, char** argv)
         ntagManager.MakeTrees(ntagOutFile);
     }
 
+    // write console output from a separate thread during the event loop,
+    // unless library output is shown in debug mode
+    Printer progressMsg("NTag", pDEFAULT, cPROGRESS);
+    Logger::SetAsync(settings.GetBool("log_async", true) && !SKIO::GetVerbose());
+
     // event loop
     for (int eventID=1; eventID<=nInputEvents; eventID++) {
-        std::cout << "\n"; msg.Print(Form("Processing Event #%d / %d...", eventID, nInputEvents));
+        if (progressMsg.IsEnabled())
+            progressMsg.Print(Form("\nProcessing Event #%d / %d...", eventID, nInputEvents));
         input.ReadEvent(eventID);
         ntagManager.ProcessEvent();
     }
@@ -154,10 +171,12 @@ int main(int argc, char** argv)
     if (!ntagManager.GetHits().IsEmpty())
         ntagManager.SearchAndFill();
 
+    Logger::SetAsync(false);
+
     // save output and exit
     ntagManager.WriteTrees();
     if (ntagOutFile)  ntagOutFile->Close();
-    if (noiseManager) delete noiseManager;
+    noiseManager.reset();
 
     return 0;
 }
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <TVector3.h>
+
+#include <geotnkC.h>
+
+#include "ArgParser.hh"
+#include "Printer.hh"
+#include "Store.hh"
+#include "SKGeometry.hh"
+#include "SKLibs.hh"
+#include "git.h"
+
+int main(int argc, char **argv)
+{
+    ArgParser parser(argc, argv);
+    Printer msg("SKGeometryCheck");
+    Store settings;
+
+    settings.ReadArguments(parser);
+    settings.Print();
+
+    // grid spacing and margin outside the inner tank (cm)
+    float step = settings.GetFloat("step", 10);
+    float margin = settings.GetFloat("margin", 100);
+    // largest allowed difference from wallsk (cm)
+    float tolerance = settings.GetFloat("tolerance", 1e-2);
+    // largest allowed wallsk at the wall point found along a direction (cm)
+    float dirTolerance = settings.GetFloat("dir_tolerance", 0.1);
+    float fvCut = 200;
+
+    if (step <= 0)
+        msg.Print("Usage: SKGeometryCheck [-step <grid spacing (cm)>] [-margin <cm>] [-tolerance <cm>] [-dir_tolerance <cm>]", pERROR);
+
+    // points on a row of x at each (y, z), each with a random direction,
+    // given to the array functions of SKGeometry
+    std::vector<float> x, y, z, dx, dy, dz, dWall, dWallInDir, effWall;
+    for (float px=-RINTK-margin; px<=RINTK+margin; px+=step)
+        x.push_back(px);
+    unsigned int nX = x.size();
+    y.resize(nX); z.resize(nX); dx.resize(nX); dy.resize(nX); dz.resize(nX);
+    dWall.resize(nX); dWallInDir.resize(nX); effWall.resize(nX);
+    std::unique_ptr<bool[]> isInFV(new bool[nX]);
+
+    std::mt19937 rng(settings.GetInt("seed", 1));
+    std::normal_distribution<float> gaus(0, 1);
+
+    unsigned long nPoints = 0, nMismatches = 0;
+    unsigned long nDirPoints = 0, nDirMismatches = 0, nFVMismatches = 0;
+    float maxDiff = 0, maxDirDiff = 0;
+    float maxDiffPoint[3] = {0, 0, 0};
+
+    for (float py=-RINTK-margin; py<=RINTK+margin; py+=step) {
+        for (float pz=ZMINTK-margin; pz<=ZPINTK+margin; pz+=step) {
+            std::fill(y.begin(), y.end(), py);
+            std::fill(z.begin(), z.end(), pz);
+            for (unsigned int iX=0; iX<nX; iX++) {
+                TVector3 dir(gaus(rng), gaus(rng), gaus(rng));
+                dir = dir.Unit();
+                dx[iX] = dir.x(); dy[iX] = dir.y(); dz[iX] = dir.z();
+            }
+            SKGeometry::GetDWall(x.data(), y.data(), z.data(), dWall.data(), nX);
+            SKGeometry::GetDWallInDirection(x.data(), y.data(), z.data(), dx.data(), dy.data(), dz.data(), dWallInDir.data(), nX);
+            SKGeometry::GetEffectiveWall(x.data(), y.data(), z.data(), dx.data(), dy.data(), dz.data(), effWall.data(), nX);
+            SKGeometry::IsInFiducialVolume(x.data(), y.data(), z.data(), isInFV.get(), nX, fvCut);
+
+            for (unsigned int iX=0; iX<nX; iX++) {
+                float point[3] = {x[iX], py, pz};
+                float dWallSK = wallsk_(point);
+                float diff = std::fabs(dWall[iX] - dWallSK);
+                float scalarDiff = std::fabs(SKGeometry::GetDWall(x[iX], py, pz) - dWallSK);
+                diff = std::max(diff, scalarDiff);
+
+                if (diff > tolerance) {
+                    if (nMismatches < 10)
+                        msg.Print(Form("(%3.2f, %3.2f, %3.2f) cm: SKGeometry::GetDWall %3.4f cm, wallsk %3.4f cm",
+                                       x[iX], py, pz, dWall[iX], dWallSK), pWARNING);
+                    nMismatches++;
+                }
+                if (diff > maxDiff) {
+                    maxDiff = diff;
+                    maxDiffPoint[0] = x[iX]; maxDiffPoint[1] = py; maxDiffPoint[2] = pz;
+                }
+                nPoints++;
+
+                // fiducial volume from wallsk, away from its boundary
+                if (std::fabs(dWallSK - fvCut) > tolerance && isInFV[iX] != (dWallSK > fvCut)) {
+                    if (nFVMismatches < 10)
+                        msg.Print(Form("(%3.2f, %3.2f, %3.2f) cm: SKGeometry::IsInFiducialVolume %d, wallsk %3.4f cm",
+                                       x[iX], py, pz, isInFV[iX], dWallSK), pWARNING);
+                    nFVMismatches++;
+                }
+
+                // points inside the tank: the points at the distances along and against the direction are on the wall
+                if (dWallSK <= 0) continue;
+                for (float sign: {1.f, -1.f}) {
+                    float distance = sign > 0 ? dWallInDir[iX] : effWall[iX];
+                    float wallPoint[3] = {x[iX] + sign*distance*dx[iX], py + sign*distance*dy[iX], pz + sign*distance*dz[iX]};
+                    float dirDiff = std::fabs(wallsk_(wallPoint));
+                    if (dirDiff > dirTolerance) {
+                        if (nDirMismatches < 10)
+                            msg.Print(Form("(%3.2f, %3.2f, %3.2f) cm, direction (%3.3f, %3.3f, %3.3f): "
+                                           "wallsk %3.4f cm at the wall point %s the direction",
+                                           x[iX], py, pz, sign*dx[iX], sign*dy[iX], sign*dz[iX], dirDiff,
+                                           sign > 0 ? "along" : "against"), pWARNING);
+                        nDirMismatches++;
+                    }
+                    maxDirDiff = std::max(maxDirDiff, dirDiff);
+                }
+                nDirPoints++;
+            }
+        }
+    }
+
+    msg.Print(Form("%lu points with %3.1f cm spacing, up to %3.1f cm outside the inner tank", nPoints, step, margin));
+    msg.Print(Form("Largest difference from wallsk: %g cm at (%3.2f, %3.2f, %3.2f) cm",
+                   maxDiff, maxDiffPoint[0], maxDiffPoint[1], maxDiffPoint[2]));
+
+    msg.Print(Form("%lu points inside the tank with random directions: largest wallsk at the wall points %g cm",
+                   nDirPoints, maxDirDiff));
+
+    if (nMismatches)
+        msg.Print(Form("%lu points differ from wallsk by more than %g cm!", nMismatches, tolerance), pWARNING);
+    if (nFVMismatches)
+        msg.Print(Form("%lu points are in a different fiducial volume from wallsk!", nFVMismatches), pWARNING);
+    if (nDirMismatches)
+        msg.Print(Form("%lu wall points along directions are more than %g cm away from the wall!",
+                       nDirMismatches, dirTolerance), pWARNING);
+    if (nMismatches || nFVMismatches || nDirMismatches)
+        return 1;
+
+    msg.Print("SKGeometry agrees with wallsk!");
+
+    return 0;
+}
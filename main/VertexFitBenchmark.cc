@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+
+#include <skheadC.h>
+
+#include "ArgParser.hh"
+#include "Calculator.hh"
+#include "PMTHitCluster.hh"
+#include "Printer.hh"
+#include "Store.hh"
+#include "SKGeometry.hh"
+#include "SKLibs.hh"
+#include "TRMSFitManager.hh"
+#include "GoodnessFitManager.hh"
+#include "BonsaiManager.hh"
+#include "git.h"
+
+// minimum distance (cm) from which the acceptance of a PMT falls as 1/distance^2
+static const float ACCEPTANCEDISTANCE = 400;
+// PMT time resolution (ns)
+static const float TRESOLUTION = 3;
+
+/**
+ * @brief Simulates the hits of a neutron capture at a random vertex in the fiducial volume.
+ * @details \c nSignal hits of PMTs picked with an acceptance falling as 1/distance^2,
+ * smeared by the PMT time resolution, on top of dark hits at \c darkRatekHz per PMT
+ * from -1 to +2 us around the capture time. The capture time is 1000 ns.
+ */
+static void SimulateCapture(std::mt19937& rng, int nSignal, float darkRatekHz, TVector3& vertex, PMTHitCluster& hits)
+{
+    std::uniform_real_distribution<float> uniform(0, 1);
+    std::uniform_int_distribution<int> pickPMT(1, MAXPM);
+    std::normal_distribution<float> gaus(0, TRESOLUTION);
+
+    do {
+        vertex = TVector3((2*uniform(rng)-1)*RINTK, (2*uniform(rng)-1)*RINTK, (2*uniform(rng)-1)*ZPINTK);
+    } while (!SKGeometry::IsInFiducialVolume(vertex.x(), vertex.y(), vertex.z()));
+
+    hits.Clear();
+    for (int iSignal=0; iSignal<nSignal;) {
+        int pmtID = pickPMT(rng);
+        auto const& pmt = NTagConstant::PMTXYZ[pmtID-1];
+        if (!pmt[0] && !pmt[1] && !pmt[2]) continue; // no PMT at this cable
+        float distance = (TVector3(pmt[0], pmt[1], pmt[2]) - vertex).Mag();
+        if (uniform(rng)*distance*distance > ACCEPTANCEDISTANCE*ACCEPTANCEDISTANCE) continue;
+        hits.Append(PMTHit(1000 + distance/NTagConstant::C_WATER + gaus(rng), 1, pmtID, 2, true));
+        iSignal++;
+    }
+
+    float tMin = 0, tMax = 3000;
+    int nDark = std::poisson_distribution<int>(darkRatekHz*1e-6 * MAXPM * (tMax-tMin))(rng);
+    for (int iDark=0; iDark<nDark; iDark++)
+        hits.Append(PMTHit(tMin + uniform(rng)*(tMax-tMin), 1, pickPMT(rng), 2));
+}
+
+int main(int argc, char **argv)
+{
+    ArgParser parser(argc, argv);
+    Printer msg("VertexFitBenchmark");
+    Store settings;
+
+    if (!GetENV("NTAGLIBPATH").empty())
+        settings.Initialize(GetENV("NTAGLIBPATH")+"/NTagConfig");
+    settings.ReadArguments(parser);
+    settings.Print();
+
+    int nEvents = settings.GetInt("nevents", 1000);
+    int nSignal = settings.GetInt("nsignal", 10);
+    float darkRatekHz = settings.GetFloat("IDDARKRATE", 7.5);
+    float promptResolution = settings.GetFloat("PVXRES");
+    float tWidth = settings.GetFloat("TRMSTWIDTH", 30);
+    int seed = settings.GetInt("NOISESEED");
+
+    if (nEvents <= 0 || nSignal <= 0)
+        msg.Print("Usage: VertexFitBenchmark -nevents <number of captures> -nsignal <signal hits per capture> "
+                  "[-IDDARKRATE <kHz>] [-PVXRES <prompt vertex resolution (cm)>] [fit options]", pERROR);
+
+    skheadg_.sk_geometry = settings.GetInt("SKGEOMETRY", 6);
+    geoset_();
+
+    // fitters to compare
+    std::vector<std::string> names;
+    std::vector<TRMSFitManager> trmsFitters;
+    for (auto const& start: {std::make_pair("center", mTankCenter), std::make_pair("prompt", mPromptVertex),
+                             std::make_pair("centroid", mHitCentroid)}) {
+        for (auto const& minimizer: {std::make_pair("grid", mGridSearch), std::make_pair("pattern", mPatternSearch)}) {
+            TRMSFitManager fitter(pNONE);
+            fitter.SetParameters(settings.GetFloat("INITGRIDWIDTH", 800), settings.GetFloat("MINGRIDWIDTH", 50),
+                                 settings.GetFloat("GRIDSHRINKRATE", 0.5), settings.GetFloat("VTXMAXRADIUS", 5000));
+            fitter.SetMinimizer(minimizer.second, settings.GetFloat("MINSTEPWIDTH", 5));
+            fitter.SetStart(start.second, settings.GetFloat("STARTRADIUS", 500));
+            trmsFitters.push_back(fitter);
+            names.push_back(std::string("trms ") + minimizer.first + " " + start.first);
+        }
+    }
+    GoodnessFitManager goodnessFitter(pNONE);
+    goodnessFitter.SetParameters(settings.GetFloat("INITGRIDWIDTH", 800), settings.GetFloat("MINGRIDWIDTH", 50),
+                                 settings.GetFloat("GRIDSHRINKRATE", 0.5), settings.GetFloat("VTXMAXRADIUS", 5000),
+                                 settings.GetFloat("MINSTEPWIDTH", 5));
+    names.push_back("goodness");
+
+    // BONSAI on the [-500, +1000] ns window of -delayed_vertex bonsai:
+    // all hits, -BSMAXNHITS hits nearest to the peak, and TRMS-fit of the peak for more than -BSTRMSNHITS hits
+    std::vector<std::unique_ptr<BonsaiManager>> bonsaiFitters;
+    int bsMaxNHits = settings.GetInt("BSMAXNHITS", 100);
+    int bsTRMSNHits = settings.GetInt("BSTRMSNHITS", 100);
+    for (int iBonsai=0; iBonsai<3; iBonsai++) {
+        bonsaiFitters.emplace_back(new BonsaiManager(pNONE));
+        bonsaiFitters.back()->Initialize();
+        bonsaiFitters.back()->SetTRMSParameters(trmsFitters[0]);
+    }
+    bonsaiFitters[1]->SetHitSelection(bsMaxNHits, 0);
+    bonsaiFitters[2]->SetHitSelection(0, bsTRMSNHits);
+    names.push_back("bonsai");
+    names.push_back(Form("bonsai max %d", bsMaxNHits));
+    names.push_back(Form("bonsai trms %d", bsTRMSNHits));
+
+    std::vector<VertexFitManager*> fitters;
+    for (auto& fitter: trmsFitters) fitters.push_back(&fitter);
+    fitters.push_back(&goodnessFitter);
+    for (auto& fitter: bonsaiFitters) fitters.push_back(fitter.get());
+
+    unsigned int nFitters = fitters.size();
+    unsigned int firstBonsai = nFitters - bonsaiFitters.size();
+    std::vector<std::vector<float>> distances(nFitters);
+    std::vector<double> fitTimes(nFitters, 0), nEvaluations(nFitters, 0);
+    double nBonsaiHits = 0;
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> uniform(0, 1);
+    std::exponential_distribution<float> promptSmearing(promptResolution > 0 ? 1./promptResolution : 1);
+    TVector3 trueVertex;
+    PMTHitCluster eventHits;
+
+    for (int iEvent=0; iEvent<nEvents; iEvent++) {
+        SimulateCapture(rng, nSignal, darkRatekHz, trueVertex, eventHits);
+
+        // prompt vertex smeared as in NTag with -PVXRES
+        TVector3 promptVertex = trueVertex;
+        if (promptResolution > 0) {
+            for (int iAxis=0; iAxis<3; iAxis++) {
+                float d = promptSmearing(rng);
+                promptVertex[iAxis] += uniform(rng) > 0.5 ? d : -d;
+            }
+        }
+        for (auto& fitter: trmsFitters) fitter.SetPromptVertex(promptVertex);
+
+        // TRMS-fit window around the capture time, ToF-subtracted from the prompt vertex
+        eventHits.SetVertex(promptVertex);
+        eventHits.Sort();
+        float tCapture = 0; int nSignalHits = 0;
+        for (auto const& hit: eventHits)
+            if (hit.s()) { tCapture += hit.t(); nSignalHits++; }
+        tCapture /= nSignalHits;
+        PMTHitCluster hitsForFit;
+        for (auto const& hit: eventHits)
+            if (fabs(hit.t() - tCapture) < tWidth/2.) hitsForFit.Append(hit);
+
+        // BONSAI window of hits without ToF-subtraction
+        eventHits.RemoveVertex();
+        eventHits.Sort();
+        PMTHitCluster bonsaiHits;
+        for (auto const& hit: eventHits)
+            if (tCapture-500 < hit.t() && hit.t() < tCapture+1000) bonsaiHits.Append(hit);
+        nBonsaiHits += bonsaiHits.GetSize();
+
+        for (unsigned int iFitter=0; iFitter<nFitters; iFitter++) {
+            auto start = std::chrono::steady_clock::now();
+            fitters[iFitter]->Fit(iFitter < firstBonsai ? hitsForFit : bonsaiHits);
+            fitTimes[iFitter] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            distances[iFitter].push_back((fitters[iFitter]->GetFitVertex() - trueVertex).Mag());
+            if (iFitter < trmsFitters.size())
+                nEvaluations[iFitter] += trmsFitters[iFitter].GetNEvaluations();
+            else if (iFitter < firstBonsai)
+                nEvaluations[iFitter] += goodnessFitter.GetNEvaluations();
+        }
+    }
+
+    msg.PrintBlock(Form("%d captures with %d signal hits, ID dark rate %3.2f kHz", nEvents, nSignal, darkRatekHz));
+    msg.Print(Form("Mean number of hits in the BONSAI window: %3.1f", nBonsaiHits/nEvents));
+    msg.Print(Form("%-20s %12s %12s %12s %10s", "Fitter", "Median (cm)", "68% (cm)", "Evaluations", "ms/fit"));
+    for (unsigned int iFitter=0; iFitter<nFitters; iFitter++) {
+        auto& fitDistances = distances[iFitter];
+        std::sort(fitDistances.begin(), fitDistances.end());
+        // BONSAI does not count its likelihood evaluations
+        std::string evaluations = iFitter < firstBonsai ? std::to_string(int(nEvaluations[iFitter]/nEvents)) : "-";
+        msg.Print(Form("%-20s %12.1f %12.1f %12s %10.3f", names[iFitter].c_str(),
+                       fitDistances[fitDistances.size()/2], fitDistances[fitDistances.size()*68/100],
+                       evaluations.c_str(), 1e3*fitTimes[iFitter]/nEvents));
+    }
+
+    return 0;
+}
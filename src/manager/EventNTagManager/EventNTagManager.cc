@@ -1,4 +1,8 @@
+#include <algorithm>
+#include <atomic>
 #include <iomanip>
+#include <sstream>
+#include <thread>
 
 #include "TFile.h"
 
@@ -29,6 +33,7 @@
 #include "GetStopMuVertex.hh"
 #include "NTagBankIO.hh"
 #include "Calculator.hh"
+#include "SKGeometry.hh"
 #include "NoiseManager.hh"
 #include "EventNTagManager.hh"
 
@@ -55,9 +60,20 @@ EventNTagManager::EventNTagManager(Verbosity verbose)
     fTRMSFitManager = TRMSFitManager(verbose);
     fBonsaiManager  = BonsaiManager(verbose);
     fBonsaiManager.Initialize();
+    fGoodnessFitManager = GoodnessFitManager(verbose);
 }
 
-EventNTagManager::~EventNTagManager() {}
+EventNTagManager::~EventNTagManager()
+{
+    if (fFitCache.IsOpen()) {
+        unsigned long nLookups = fFitCache.GetNLookups();
+        fMsg.Print(Form("Fit cache %s: %lu / %lu fits found (%3.2f%%), %lu key collisions, %lu bytes read, %lu bytes written",
+                        fFitCache.GetFilePath().c_str(), fFitCache.GetNFound(), nLookups,
+                        nLookups ? 100.*fFitCache.GetNFound()/nLookups : 0., fFitCache.GetNCollisions(),
+                        fFitCache.GetBytesRead(), fFitCache.GetBytesWritten()));
+        fFitCache.Close();
+    }
+}
 
 void EventNTagManager::ReadPromptVertex(VertexMode mode)
 {
@@ -242,10 +258,12 @@ void EventNTagManager::ReadVariables()
 
 void EventNTagManager::ReadHits()
 {
-    fEventHits = PMTHitCluster(sktqz_);
+    fEventHits.Clear();
+    fEventHits.AddSKTQZ(sktqz_);
     fEventHits.Sort();
 
-    fEventODHits = PMTHitCluster(sktqaz_);
+    fEventODHits.Clear();
+    fEventODHits.AddSKTQAZ(sktqaz_);
     fEventODHits.Sort();
 }
 
@@ -307,12 +325,13 @@ void EventNTagManager::AddHits()
 
     fEventVariables.Set("HitAppendError", 0);
     if (fEventHits.IsEmpty()) {
-        fEventHits.Append(PMTHitCluster(sktqz_) + tOffset, true);
-        fEventODHits.Append(PMTHitCluster(sktqaz_) + tOffset, true);
+        fEventHits.AddSKTQZ(sktqz_, tOffset, true);
+        fEventODHits.AddSKTQAZ(sktqaz_, tOffset, true);
     }
     else {
-        auto hitsToAdd = PMTHitCluster(sktqz_) + tOffset;
-        auto odHitsToAdd = PMTHitCluster(sktqaz_) + tOffset;
+        PMTHitCluster hitsToAdd, odHitsToAdd;
+        hitsToAdd.AddSKTQZ(sktqz_, tOffset);
+        odHitsToAdd.AddSKTQAZ(sktqaz_, tOffset);
 
         bool idAddOK = fEventHits.AppendByCoincidence(hitsToAdd);
         bool odAddOK = fEventODHits.AppendByCoincidence(odHitsToAdd);
@@ -381,7 +400,7 @@ void EventNTagManager::ReadEarlyCandidates()
                 candidate.Set("dirx", apmue_.apmuedir[iMuE][0]);
                 candidate.Set("diry", apmue_.apmuedir[iMuE][1]);
                 candidate.Set("dirz", apmue_.apmuedir[iMuE][2]);
-                candidate.Set("DWall", wallsk_(apmue_.apmuepos[iMuE]));
+                candidate.Set("DWall", SKGeometry::GetDWall(apmue_.apmuepos[iMuE][0], apmue_.apmuepos[iMuE][1], apmue_.apmuepos[iMuE][2]));
                 candidate.Set("NHits", apmue_.apmuenhit[iMuE]);
                 candidate.Set("GateType", apmue_.apmuetype[iMuE]);
                 candidate.Set("Goodness", apmue_.apmuegood[iMuE]);
@@ -455,6 +474,8 @@ void EventNTagManager::ProcessEvent()
         auto nnType = fSettings.GetString("NN_type");
         auto weightPath = fSettings.GetString("weight");
         auto delayedMode = fSettings.GetString("delayed_vertex");
+        // goodness-fit has no weights of its own yet: it fits the same window as TRMS-fit
+        if (delayedMode=="goodness") delayedMode = "trms";
         if (nnType=="tmva") {
             if (weightPath=="default")
                 weightPath = delayedMode;
@@ -531,6 +552,7 @@ void EventNTagManager::SearchCandidates()
     int   NHitsPrevious   = 0;
     int   N200Previous    = 0;
     Float t0Previous      = std::numeric_limits<Float>::min();
+    std::vector<unsigned int> candidateHitIDs;
 
     int nEventHits = fEventVariables.GetInt("NAllHits");
     int nIDHitsMax = fSettings.GetInt("NIDHITMX", std::numeric_limits<int>::max());
@@ -573,7 +595,7 @@ void EventNTagManager::SearchCandidates()
             // Also check if N200Previous is below N200 cut and if t0Previous is over t0 threshold
             if (t0New - t0Previous > TMINPEAKSEP) {
                 if (iHitPrevious >= 0 && N200Previous < N200MX && t0Previous > T0TH) {
-                    FindDelayedCandidate(iHitPrevious);
+                    candidateHitIDs.push_back(iHitPrevious);
                 }
                 // Reset NHitsPrevious,
                 // if peaks are separated enough
@@ -591,7 +613,9 @@ void EventNTagManager::SearchCandidates()
 
         // Save the last peak
         if (NHitsPrevious >= NHITSTH)
-            FindDelayedCandidate(iHitPrevious);
+            candidateHitIDs.push_back(iHitPrevious);
+
+        FindDelayedCandidates(candidateHitIDs);
     }
     if (!fEventEarlyCandidates.IsEmpty()) PruneCandidates();
     /*if (fIsMC)*/  MapTaggables();
@@ -672,6 +696,8 @@ void EventNTagManager::ApplySettings()
 
     if (fDelayedVertexMode == mTRMS)
         fDelayedVertexManager = &fTRMSFitManager;
+    else if (fDelayedVertexMode == mGOODNESS)
+        fDelayedVertexManager = &fGoodnessFitManager;
     else if (fDelayedVertexMode == mBONSAI) {
         fDelayedVertexManager = &fBonsaiManager;
     }
@@ -716,11 +742,29 @@ void EventNTagManager::ApplySettings()
         }
     }
     else if (fDelayedVertexMode != mPROMPT){
-        fMsg.Print("Delayed vertex mode should be one of \"trms\", \"bonsai\", or \"prompt\".", pWARNING);
+        fMsg.Print("Delayed vertex mode should be one of \"trms\", \"goodness\", \"bonsai\", or \"prompt\".", pWARNING);
         fMsg.Print("Setting delayed vertex mode as \"prompt\"...", pWARNING);
         fDelayedVertexMode = mPROMPT;
     }
 
+    // delayed vertex fit threads
+    FITTHREADS = std::max(1, fSettings.GetInt("fit_threads", 1));
+
+    // delayed vertex fit cache
+    auto fitCachePath = fSettings.GetString("fit_cache");
+    if (!fitCachePath.empty() && fitCachePath != fFitCache.GetFilePath()) {
+        if (fFitCache.Open(fitCachePath))
+            fMsg.Print(Form("Fit cache %s: %lu fit results", fitCachePath.c_str(), fFitCache.GetNRecords()));
+        else
+            fMsg.Print(Form("Could not open %s as a fit cache. Fitting all delayed vertices...", fitCachePath.c_str()), pWARNING);
+    }
+    if (FITTHREADS > 1 && fDelayedVertexMode == mLOWFIT)
+        fMsg.Print("LOWFIT uses Fortran common blocks and cannot run on multiple threads. Fitting delayed vertices serially...", pWARNING);
+
+    // BONSAI hit selection for large fit windows
+    BSNHITSMX = fSettings.GetInt("BSNHITSMX", 2000);
+    fBonsaiManager.SetHitSelection(fSettings.GetInt("BSMAXNHITS", 0), fSettings.GetInt("BSTRMSNHITS", 0));
+
     fSettings.Get("TRMSTWIDTH", TRMSTWIDTH);
     fSettings.Get("INITGRIDWIDTH", INITGRIDWIDTH);
     fSettings.Get("MINGRIDWIDTH", MINGRIDWIDTH);
@@ -728,6 +772,32 @@ void EventNTagManager::ApplySettings()
     fSettings.Get("VTXMAXRADIUS", VTXMAXRADIUS);
 
     fTRMSFitManager.SetParameters(INITGRIDWIDTH, MINGRIDWIDTH, GRIDSHRINKRATE, VTXMAXRADIUS);
+    fGoodnessFitManager.SetParameters(INITGRIDWIDTH, MINGRIDWIDTH, GRIDSHRINKRATE, VTXMAXRADIUS,
+                                      fSettings.GetFloat("MINSTEPWIDTH", 5));
+
+    // TRMS minimizer
+    auto trmsMinimizer = fSettings.GetString("trms_fit", "grid");
+    if (trmsMinimizer != "grid" && trmsMinimizer != "pattern") {
+        fMsg.Print(Form("%s is not a valid trms_fit option... using grid by default...", trmsMinimizer.c_str()), pWARNING);
+        trmsMinimizer = "grid";
+    }
+    fTRMSFitManager.SetMinimizer(trmsMinimizer == "pattern" ? mPatternSearch : mGridSearch,
+                                 fSettings.GetFloat("MINSTEPWIDTH", 5));
+
+    auto trmsStart = fSettings.GetString("trms_start", "center");
+    if (trmsStart == "prompt" && fPromptVertexMode == mNONE) {
+        fMsg.Print("TRMS-fit cannot start from the prompt vertex with prompt vertex mode \"none\"... using center by default...", pWARNING);
+        trmsStart = "center";
+    }
+    else if (trmsStart != "center" && trmsStart != "prompt" && trmsStart != "centroid") {
+        fMsg.Print(Form("%s is not a valid trms_start option... using center by default...", trmsStart.c_str()), pWARNING);
+        trmsStart = "center";
+    }
+    fTRMSFitManager.SetStart(trmsStart == "prompt" ? mPromptVertex : (trmsStart == "centroid" ? mHitCentroid : mTankCenter),
+                             fSettings.GetFloat("STARTRADIUS", 500));
+
+    // TRMS-fit of the largest BONSAI fit windows (-BSTRMSNHITS) uses the same settings
+    fBonsaiManager.SetTRMSParameters(fTRMSFitManager);
 }
 
 void EventNTagManager::ReadArguments(const ArgParser& argParser)
@@ -765,6 +835,8 @@ void EventNTagManager::SetVertexMode(VertexMode& mode, std::string key)
         mode = mPROMPT;
     else if (key == "lowfit")
         mode = mLOWFIT;
+    else if (key == "goodness")
+        mode = mGOODNESS;
     else
         fMsg.Print("Vertex mode " + key + " is not a proper mode name!", pERROR);
 }
@@ -855,12 +927,12 @@ void EventNTagManager::ClearData()
 void EventNTagManager::DumpEvent()
 {
     bool debug = fSettings.GetBool("debug", false);
-    std::cout << "\n\n\n\n";
+    Logger::Write(cEVENT, "\n\n\n\n");
     if (debug) fEventVariables.Print();
     DumpEventVariables();
     if (debug) fEventParticles.DumpAllElements();
     if (debug) fEventTaggables.DumpAllElements();
-    if (fSettings.GetBool("print", true)) {
+    if (fSettings.GetBool("print", true) && Logger::IsEnabled(cCANDIDATE)) {
         fEventEarlyCandidates.DumpAllElements({"FitT", "NHits", "DWall", "Goodness",
                                                "Label", "TagIndex", "fvx", "fvy", "fvz", "DTaggable", "TagClass"});
         fEventCandidates.DumpAllElements(Split(fSettings.GetString("print"), ","), !fSettings.GetBool("debug", false));
@@ -869,98 +941,107 @@ void EventNTagManager::DumpEvent()
 
 void EventNTagManager::DumpEventVariables()
 {
-    fMsg.PrintBlock("Event summary", pSUBEVENT, pDEFAULT, false);
+    Printer eventMsg("NTagManager", fMsg.GetVerbosity(), cEVENT);
+    if (!eventMsg.IsEnabled()) return;
+
+    eventMsg.PrintBlock("Event summary", pSUBEVENT, pDEFAULT, false);
+    std::ostringstream table;
 
     // Event header
-    std::cout << "\n\033[1;36m* Event header\033[m\n";
-    std::cout << "\033[4mRun       Subrun    Event     Evis (MeV)\033[0m\n";
-    std::cout << std::left << std::setw(10) << fEventVariables.GetInt("RunNo");
-    std::cout << std::left << std::setw(10) << fEventVariables.GetInt("SubrunNo");
-    std::cout << std::left << std::setw(10) << fEventVariables.GetInt("EventNo");
-    std::cout << std::left << std::setw(10) << fEventVariables.GetString("EVis", "-");
-    std::cout << std::endl;
-    std::cout << "\n\033[4mQISMSK (p.e.)       OD Hits             \033[0m\n";
-    std::cout << std::left << std::setw(20) << fEventVariables.GetFloat("QISMSK");
-    std::cout << std::left << std::setw(20) << fEventVariables.GetInt("NHITAC");
-    std::cout << std::endl;
+    table << "\n\033[1;36m* Event header\033[m\n";
+    table << "\033[4mRun       Subrun    Event     Evis (MeV)\033[0m\n";
+    table << std::left << std::setw(10) << fEventVariables.GetInt("RunNo");
+    table << std::left << std::setw(10) << fEventVariables.GetInt("SubrunNo");
+    table << std::left << std::setw(10) << fEventVariables.GetInt("EventNo");
+    table << std::left << std::setw(10) << fEventVariables.GetString("EVis", "-");
+    table << std::endl;
+    table << "\n\033[4mQISMSK (p.e.)       OD Hits             \033[0m\n";
+    table << std::left << std::setw(20) << fEventVariables.GetFloat("QISMSK");
+    table << std::left << std::setw(20) << fEventVariables.GetInt("NHITAC");
+    table << std::endl;
 
     // Trigger information
-    std::cout << "\n\033[1;36m* Trigger\033[m\n";
-    std::cout << "\033[4mTrgType   MCTrgOffset (ns)   TDiff (ms) \033[0m\n";
-    std::cout << std::left << std::setw(10);
+    table << "\n\033[1;36m* Trigger\033[m\n";
+    table << "\033[4mTrgType   MCTrgOffset (ns)   TDiff (ms) \033[0m\n";
+    table << std::left << std::setw(10);
     auto trgType = fEventVariables.GetInt("TrgType");
 
-    if      (trgType == 1) std::cout << "SHE-only";
-    else if (trgType == 2) std::cout << "SHE+AFT";
-    else if (trgType == 3) std::cout << "LE";
-    else if (trgType == 4) std::cout << "HE";
-    else                   std::cout << "Other";
-    std::cout << std::left << std::setw(17);
+    if      (trgType == 1) table << "SHE-only";
+    else if (trgType == 2) table << "SHE+AFT";
+    else if (trgType == 3) table << "LE";
+    else if (trgType == 4) table << "HE";
+    else                   table << "Other";
+    table << std::left << std::setw(17);
     auto trgOffset = fEventVariables.GetString("MCT0", "-");
     auto tDiff = fEventVariables.GetFloat("TDiff");
-    std::cout << std::left << std::setw(13);
-    if (fIsMC) std::cout << "-";
-    else        std::cout << tDiff;
-    std::cout << std::endl;
+    table << std::left << std::setw(13);
+    if (fIsMC) table << "-";
+    else        table << tDiff;
+    table << std::endl;
 
     // Prompt vertex
-    std::cout << "\n\033[1;36m* Prompt vertex                        \033[m\n";
-    std::cout << "\033[4mX (cm)    Y (cm)    Z (cm)    DWall (cm)\033[0m\n";
-    std::cout << std::left << std::setw(10) << fEventVariables.GetFloat("pvx");
-    std::cout << std::left << std::setw(10) << fEventVariables.GetFloat("pvy");
-    std::cout << std::left << std::setw(10) << fEventVariables.GetFloat("pvz");
-    std::cout << std::left << std::setw(10) << Form("%3.0f", fEventVariables.GetFloat("DWall"));
-    std::cout << std::endl;
+    table << "\n\033[1;36m* Prompt vertex                        \033[m\n";
+    table << "\033[4mX (cm)    Y (cm)    Z (cm)    DWall (cm)\033[0m\n";
+    table << std::left << std::setw(10) << fEventVariables.GetFloat("pvx");
+    table << std::left << std::setw(10) << fEventVariables.GetFloat("pvy");
+    table << std::left << std::setw(10) << fEventVariables.GetFloat("pvz");
+    table << std::left << std::setw(10) << Form("%3.0f", fEventVariables.GetFloat("DWall"));
+    table << std::endl;
 
     // True vertex (MC)
-    std::cout << "\n\033[1;36m* MC true vertex                        \033[m\n";
-    std::cout << "\033[4mX (cm)    Y (cm)    Z (cm)     Error (cm)\033[0m\n";
-    std::cout << std::left << std::setw(10) << fEventVariables.GetFloat("vecvx");
-    std::cout << std::left << std::setw(10) << fEventVariables.GetFloat("vecvy");
-    std::cout << std::left << std::setw(10) << fEventVariables.GetFloat("vecvz");
-    std::cout << std::left << std::setw(10) << Form("%3.0f", fEventVariables.GetFloat("VtxRes"));
-    std::cout << std::endl;
+    table << "\n\033[1;36m* MC true vertex                        \033[m\n";
+    table << "\033[4mX (cm)    Y (cm)    Z (cm)     Error (cm)\033[0m\n";
+    table << std::left << std::setw(10) << fEventVariables.GetFloat("vecvx");
+    table << std::left << std::setw(10) << fEventVariables.GetFloat("vecvy");
+    table << std::left << std::setw(10) << fEventVariables.GetFloat("vecvz");
+    table << std::left << std::setw(10) << Form("%3.0f", fEventVariables.GetFloat("VtxRes"));
+    table << std::endl;
 
     // Number of total hits
-    std::cout << "\n\033[1;36m* Number of hits in search range       \033[m\n";
-    std::cout << "\033[4mID                 OD                   \033[0m\n";
-    std::cout << std::left << std::setw(20) << fEventVariables.GetInt("NAllHits");
-    std::cout << std::left << std::setw(20) << fEventVariables.GetInt("NAllODHits");
-    std::cout << std::endl;
+    table << "\n\033[1;36m* Number of hits in search range       \033[m\n";
+    table << "\033[4mID                 OD                   \033[0m\n";
+    table << std::left << std::setw(20) << fEventVariables.GetInt("NAllHits");
+    table << std::left << std::setw(20) << fEventVariables.GetInt("NAllODHits");
+    table << std::endl;
 
     // Number of total hits
-    std::cout << "\n\033[1;36m* Number of taggables                  \033[m\n";
-    std::cout << "\033[4mID                 OD                   \033[0m\n";
-    std::cout << std::left << std::setw(20) << fEventVariables.GetInt("NAllHits");
-    std::cout << std::left << std::setw(20) << fEventVariables.GetInt("NAllODHits");
-    std::cout << std::endl;
+    table << "\n\033[1;36m* Number of taggables                  \033[m\n";
+    table << "\033[4mID                 OD                   \033[0m\n";
+    table << std::left << std::setw(20) << fEventVariables.GetInt("NAllHits");
+    table << std::left << std::setw(20) << fEventVariables.GetInt("NAllODHits");
+    table << std::endl;
+
+    Logger::Write(cEVENT, table.str());
 }
 
-void EventNTagManager::DumpHitReductionResults(std::vector<HitReductionResult> resVec)
+void EventNTagManager::DumpHitReductionResults(const std::vector<HitReductionResult>& resVec)
 {
-    std::cout << "                                              Before         Matched           After " << std::endl;
-    std::cout << "\033[4m No. Cut                Range (usec)   Range /   All   Range /   All   Range /   All \033[0m" << std::endl;
+    std::ostringstream table;
+    table << "                                              Before         Matched           After " << std::endl;
+    table << "\033[4m No. Cut                Range (usec)   Range /   All   Range /   All   Range /   All \033[0m" << std::endl;
     int iCut = 0;
     for (auto const& res: resVec) {
-        std::cout << std::right << std::setw(3) << iCut+1 << "  ";
-        std::cout << std::left << std::setw(16) << res.title << " ";
+        table << std::right << std::setw(3) << iCut+1 << "  ";
+        table << std::left << std::setw(16) << res.title << " ";
         if ( std::isinf(res.tMin) && std::isinf(res.tMax)) {
-            std::cout << std::right << std::setw(14) << "      -     " << " ";
-            std::cout << std::right << std::setw(15) << Form("        %6d", res.nBeforeRange, res.nBeforeWhole) << " ";
-            std::cout << std::right << std::setw(15) << Form("        %6d", res.nRemoved, res.nMatch) << " ";
-            std::cout << std::right << std::setw(15) << Form("        %6d", res.nAfterRange, res.nAfterWhole) << " ";
+            table << std::right << std::setw(14) << "      -     " << " ";
+            table << std::right << std::setw(15) << Form("        %6d", res.nBeforeRange, res.nBeforeWhole) << " ";
+            table << std::right << std::setw(15) << Form("        %6d", res.nRemoved, res.nMatch) << " ";
+            table << std::right << std::setw(15) << Form("        %6d", res.nAfterRange, res.nAfterWhole) << " ";
         }
         else {
-            std::cout << std::right << std::setw(14) << Form("[%4.0f, %4.0f]", res.tMin*1e-3-1, res.tMax*1e-3-1) << " ";
-            std::cout << std::right << std::setw(15) << Form("%6d /%6d", res.nBeforeRange, res.nBeforeWhole) << " ";
-            std::cout << std::right << std::setw(15) << Form("%6d /%6d", res.nRemoved, res.nMatch) << " ";
-            std::cout << std::right << std::setw(15) << Form("%6d /%6d", res.nAfterRange, res.nAfterWhole) << " ";
+            table << std::right << std::setw(14) << Form("[%4.0f, %4.0f]", res.tMin*1e-3-1, res.tMax*1e-3-1) << " ";
+            table << std::right << std::setw(15) << Form("%6d /%6d", res.nBeforeRange, res.nBeforeWhole) << " ";
+            table << std::right << std::setw(15) << Form("%6d /%6d", res.nRemoved, res.nMatch) << " ";
+            table << std::right << std::setw(15) << Form("%6d /%6d", res.nAfterRange, res.nAfterWhole) << " ";
         }
-        std::cout << "\n";
+        table << "\n";
         iCut++;
     }
 
-    std::cout << "\n";
+    table << "\n";
+
+    Logger::Write(cHITS, table.str());
 }
 
 void EventNTagManager::CheckMC()
@@ -985,44 +1066,52 @@ void EventNTagManager::PrepareEventHits()
     FindReferenceRun();
 
     // Beginning of PMT hit reduction:
-    // 4 reduction steps
+    // 4 reduction steps, applied in a single pass
     // (1) Remove bad PMT channels
     // (2) Apply PMT deadtime
     // (3) Remove negative Q hits
     // (4) Remove large Q hits (optional, affects only search range)
 
-    std::vector<HitReductionResult> idHitReducRes;
-    std::vector<HitReductionResult> odHitReducRes;
+    std::vector<HitReductionStep> idHitReducSteps;
+    std::vector<HitReductionStep> odHitReducSteps;
 
     // (1) Remove bad PMT channels
     bool doRemoveBad = TString(fSettings.GetString("SKOPTN")).Contains("25");
-
-    int nBadIDHits = 0;
     if (doRemoveBad) {
-        idHitReducRes.push_back(fEventHits.RemoveBadChannels());
-        odHitReducRes.push_back(fEventODHits.RemoveBadChannels());
-        nBadIDHits = idHitReducRes.back().nRemoved;
+        idHitReducSteps.push_back(fEventHits.GetBadChannelStep());
+        odHitReducSteps.push_back(fEventODHits.GetBadChannelStep());
     }
-    fEventVariables.Set("NBadHits", nBadIDHits);
 
     // (2) Apply PMT deadtime
-    idHitReducRes.push_back(fEventHits.ApplyDeadtime(PMTDEADTIME, true));
-    fEventVariables.Set("NDeadHitsByNoise",  idHitReducRes.back().nRemovedByNoise);
-    fEventVariables.Set("NDeadHitsBySignal", idHitReducRes.back().nRemovedBySignal);
-    fEventHits.SetBurstFlag(TRBNWIDTH);
+    DeadtimeCut deadtimeCut(PMTDEADTIME);
+    unsigned int iDeadtimeStep = idHitReducSteps.size();
+    idHitReducSteps.push_back(PMTHitCluster::GetDeadtimeStep(deadtimeCut, PMTDEADTIME));
 
     // (3) Remove negative Q hits
-    idHitReducRes.push_back(fEventHits.RemoveNegativeHits());
-    odHitReducRes.push_back(fEventODHits.RemoveNegativeHits());
-    fEventVariables.Set("NNegativeHits", idHitReducRes.back().nRemoved);
+    unsigned int iNegativeQStep = idHitReducSteps.size();
+    idHitReducSteps.push_back(PMTHitCluster::GetNegativeQStep());
+    odHitReducSteps.push_back(PMTHitCluster::GetNegativeQStep());
 
     // (4) Remove large Q hits (optional, affects only search range)
-    if (fSettings.HasKey("QMAX")) {
+    // the search range is in ToF-subtracted time, while deadtime uses hit times without ToF-subtraction
+    bool doRemoveLargeQ = fSettings.HasKey("QMAX");
+    if (doRemoveLargeQ) {
         ResetEventHitsVertex();
-        idHitReducRes.push_back(fEventHits.RemoveLargeQHits(QMAX, T0TH, T0MX));
-        fEventVariables.Set("NLargeQHits", idHitReducRes.back().nRemoved);
+        idHitReducSteps.push_back(PMTHitCluster::GetLargeQStep(QMAX, T0TH, T0MX));
     }
 
+    auto idHitReducRes = fEventHits.ApplyReductions(idHitReducSteps);
+    auto odHitReducRes = fEventODHits.ApplyReductions(odHitReducSteps);
+
+    fEventVariables.Set("NBadHits", doRemoveBad ? idHitReducRes.front().nRemoved : 0);
+    deadtimeCut.FillResult(idHitReducRes[iDeadtimeStep]);
+    fEventVariables.Set("NDeadHitsByNoise",  idHitReducRes[iDeadtimeStep].nRemovedByNoise);
+    fEventVariables.Set("NDeadHitsBySignal", idHitReducRes[iDeadtimeStep].nRemovedBySignal);
+    fEventHits.SetBurstFlag(TRBNWIDTH);
+    fEventVariables.Set("NNegativeHits", idHitReducRes[iNegativeQStep].nRemoved);
+    if (doRemoveLargeQ)
+        fEventVariables.Set("NLargeQHits", idHitReducRes.back().nRemoved);
+
     ResetEventHitsVertex();
     int allIDSize = fEventHits.CountRange(T0TH, T0MX);
     int allODSize = fEventODHits.CountRange(T0TH, T0MX);
@@ -1030,18 +1119,21 @@ void EventNTagManager::PrepareEventHits()
     fEventVariables.Set("NAllODHits", allODSize);
 
     // print out hit reduction results
-    std::cout << "\n";
-    fMsg.Print("ID hit reduction results:");
-    DumpHitReductionResults(idHitReducRes);
-    fMsg.Print(Form("Remaining ID hits in search range [%4.0f, %4.0f] usec (correct_tof = %s): ",
-                    T0TH*1e-3-1, T0MX*1e-3-1, fSettings.GetString("correct_tof").c_str()));
-    fMsg.Print(Form("%d / %d hits\n", allIDSize, fEventHits.GetSize()));
-
-    fMsg.Print("OD hit reduction results:");
-    DumpHitReductionResults(odHitReducRes);
-    fMsg.Print(Form("Remaining OD hits in search range [%6.2f, %6.2f] usec: ",
-                    T0TH*1e-3-1, T0MX*1e-3-1));
-    fMsg.Print(Form("%d / %d hits\n", allODSize, fEventODHits.GetSize()));
+    Printer hitMsg("NTagManager", fMsg.GetVerbosity(), cHITS);
+    if (hitMsg.IsEnabled()) {
+        Logger::Write(cHITS, "\n");
+        hitMsg.Print("ID hit reduction results:");
+        DumpHitReductionResults(idHitReducRes);
+        hitMsg.Print(Form("Remaining ID hits in search range [%4.0f, %4.0f] usec (correct_tof = %s): ",
+                          T0TH*1e-3-1, T0MX*1e-3-1, fSettings.GetString("correct_tof").c_str()));
+        hitMsg.Print(Form("%d / %d hits\n", allIDSize, fEventHits.GetSize()));
+
+        hitMsg.Print("OD hit reduction results:");
+        DumpHitReductionResults(odHitReducRes);
+        hitMsg.Print(Form("Remaining OD hits in search range [%6.2f, %6.2f] usec: ",
+                          T0TH*1e-3-1, T0MX*1e-3-1));
+        hitMsg.Print(Form("%d / %d hits\n", allODSize, fEventODHits.GetSize()));
+    }
 
     // End of hit reduction
     // Set event variables
@@ -1095,64 +1187,220 @@ void EventNTagManager::PrepareEventHits()
 //    fEventHits.RemoveVertex();
 //}
 
-void EventNTagManager::FindDelayedCandidate(unsigned int iHit)
+void EventNTagManager::FindDelayedCandidates(const std::vector<unsigned int>& hitIDs)
 {
-    PMTHit firstHit = fEventHits[iHit];
-    auto trgHits = fEventHits.Slice(iHit, TWIDTH);
-
-    // set default values for delayed candidate properties
-    TVector3 delayedVertex = fPromptVertex;
-
-    Float delayedTime = firstHit.t() + TWIDTH/2.;
-    float delayedGoodness = 0;
+    std::vector<DelayedVertexFit> fits;
+    PrepareDelayedVertexFits(hitIDs, fits);
+    FitDelayedVertices(fits);
+
+    // each candidate is checked against the previous one,
+    // so candidates are accepted in time order
+    for (auto const& fit: fits)
+        FindDelayedCandidate(fit);
+}
 
-    bool doFit = true;
+void EventNTagManager::PrepareDelayedVertexFits(const std::vector<unsigned int>& hitIDs, std::vector<DelayedVertexFit>& fits)
+{
+    fits.clear();
+    fits.reserve(hitIDs.size());
+
+    // set default values for delayed candidate properties:
+    // BONSAI variables stay -1 (as BonsaiManager without a fit) unless the candidate is fit by BONSAI
+    for (auto const& iHit: hitIDs) {
+        PMTHit firstHit = fEventHits[iHit];
+        fits.push_back({.iHit=iHit, .firstHit=firstHit, .hitsForFit=PMTHitCluster(), .timeOffset=firstHit.t(),
+                        .doFit=(fDelayedVertexMode != mPROMPT), .isFitGood=false, .cacheKey=0, .checkKey=0,
+                        .vertex=fPromptVertex, .time=Float(firstHit.t()+TWIDTH/2.), .fitTime=0, .goodness=0,
+                        .energy=-1, .dirKS=-1, .ovaQ=-1});
+    }
 
     // prompt mode: delayed vertex = prompt vertex
     if (fDelayedVertexMode == mPROMPT) {
-        if (fPromptVertexMode != mNONE)
-            delayedGoodness = fDelayedVertexManager->GetGoodness(trgHits, fPromptVertex, delayedTime);
-        else
-            fMsg.Print("MODE ERROR: Prompt vertex mode is NONE while delayed vertex mode is PROMPT!", pERROR);
+        for (auto& fit: fits) {
+            if (fPromptVertexMode == mNONE)
+                fMsg.Print("MODE ERROR: Prompt vertex mode is NONE while delayed vertex mode is PROMPT!", pERROR);
+            auto trgHits = fEventHits.Slice(fit.iHit, TWIDTH);
+            fit.goodness = VertexFitManager::GetGoodness(trgHits, fPromptVertex, fit.time);
+        }
     }
 
-    // delayed mode: apply delayed vertex fit
-    else {
-        PMTHitCluster hitsForFit;
+    // TRMS-fit and goodness-fit
+    else if (fDelayedVertexMode == mTRMS || fDelayedVertexMode == mGOODNESS) {
+        for (auto& fit: fits)
+            fit.hitsForFit = fEventHits.Slice(fit.iHit, (TWIDTH-TRMSTWIDTH)/2., (TWIDTH+TRMSTWIDTH)/2.) - fit.timeOffset + 1000;
+    }
 
-        // TRMS-fit
-        if (fDelayedVertexMode == mTRMS)
-            hitsForFit = fEventHits.Slice(iHit, (TWIDTH-TRMSTWIDTH)/2., (TWIDTH+TRMSTWIDTH)/2.) - firstHit.t() + 1000;
+    // BONSAI: windows of all candidates are taken from the hits without ToF at once
+    else if (fDelayedVertexMode == mBONSAI || fDelayedVertexMode == mLOWFIT) {
+        fEventHits.RemoveVertex();
+        fEventHits.Sort();
+        Float tLeft  = fDelayedVertexMode == mLOWFIT ? -520 : -500;
+        Float tRight = fDelayedVertexMode == mLOWFIT ?  780 : 1000;
 
-        // BONSAI
-        else if (fDelayedVertexMode == mBONSAI || fDelayedVertexMode == mLOWFIT) {
-            fEventHits.RemoveVertex();
-            fEventHits.Sort();
+        for (auto& fit: fits) {
+            PMTHit firstHit = fit.firstHit;
             firstHit.UnsetToFAndDirection();
+            fit.timeOffset = firstHit.t();
             unsigned int firstHitID = fEventHits.GetIndex(firstHit);
-            Float tLeft  = fDelayedVertexMode == mLOWFIT ? -520 : -500;
-            Float tRight = fDelayedVertexMode == mLOWFIT ?  780 : 1000;
-            hitsForFit = fEventHits.Slice(firstHitID, TWIDTH/2.+tLeft, TWIDTH/2.+tRight) - firstHit.t() + 1000;
-
-            // give up bonsai fit for N1300 larger than 2000
-            auto nHitsForFit = hitsForFit.GetSize();
-            if (nHitsForFit > 2000) {
-                fMsg.Print(Form("A possible candidate at T=%3.2f us has N%d=%d that is larger than 2000,"
+            fit.hitsForFit = fEventHits.Slice(firstHitID, TWIDTH/2.+tLeft, TWIDTH/2.+tRight) - fit.timeOffset + 1000;
+
+            // give up bonsai fit for N1300 larger than BSNHITSMX
+            int nHitsForFit = fit.hitsForFit.GetSize();
+            if (nHitsForFit > BSNHITSMX) {
+                fMsg.Print(Form("A possible candidate at T=%3.2f us has N%d=%d that is larger than %d,"
                                 " giving up fit and setting the delayed vertex the same as the prompt vertex (%3.2f, %3.2f, %3.2f)...",
-                                firstHit.t()*1e-3, int(tRight-tLeft), nHitsForFit, delayedVertex.x(), delayedVertex.y(), delayedVertex.z()), pWARNING);
-                doFit = false;
+                                firstHit.t()*1e-3, int(tRight-tLeft), nHitsForFit, BSNHITSMX, fit.vertex.x(), fit.vertex.y(), fit.vertex.z()), pWARNING);
+                fit.doFit = false;
+            }
+        }
+
+        ResetEventHitsVertex();
+    }
+
+    for (auto& fit: fits)
+        if (fit.doFit) fit.hitsForFit.Sort();
+}
+
+void EventNTagManager::FitDelayedVertices(std::vector<DelayedVertexFit>& fits)
+{
+    std::vector<DelayedVertexFit*> jobs;
+    for (auto& fit: fits)
+        if (fit.doFit) jobs.push_back(&fit);
+
+    if (jobs.empty()) return;
+
+    fTRMSFitManager.SetPromptVertex(fPromptVertex);
+    if (fDelayedVertexMode == mBONSAI)
+        fBonsaiManager.SetTRMSParameters(fTRMSFitManager);
+
+    // take results of the same fit windows from the cache, and fit the rest
+    if (fFitCache.IsOpen()) {
+        std::vector<DelayedVertexFit*> newJobs;
+        for (auto& job: jobs) {
+            FitCacheRecord record;
+            job->cacheKey = fDelayedVertexManager->GetCacheKey(job->hitsForFit, job->checkKey);
+            if (!fFitCache.Find(job->cacheKey, job->checkKey, job->hitsForFit.GetSize(), record)) {
+                newJobs.push_back(job);
+                continue;
+            }
+            job->vertex   = TVector3(record.vertex);
+            job->fitTime  = record.time;
+            job->time     = job->fitTime + job->timeOffset - 1000;
+            job->goodness = record.goodness;
+            job->isFitGood = true;
+            if (fDelayedVertexMode == mBONSAI || fDelayedVertexMode == mLOWFIT) {
+                job->energy = record.aux[0]; job->dirKS = record.aux[1]; job->ovaQ = record.aux[2];
             }
         }
+        jobs = newJobs;
+    }
+
+    // fitters that are not thread-safe (LOWFIT with Fortran common blocks) run serially
+    unsigned int nThreads = std::min<unsigned int>(FITTHREADS, jobs.size());
+    if (nThreads <= 1 || !fDelayedVertexManager->IsThreadSafe()) {
+        for (auto& job: jobs)
+            FitDelayedVertex(fDelayedVertexManager, *job);
+    }
+    else {
+        // largest windows first, so that a long fit is not left to the end
+        std::stable_sort(jobs.begin(), jobs.end(), [](const DelayedVertexFit* a, const DelayedVertexFit* b)
+                                                     { return a->hitsForFit.GetSize() > b->hitsForFit.GetSize(); });
+
+        // each thread takes the next job until none is left;
+        // results are written to the fit of each job, which stays in candidate order
+        auto workers = GetFitWorkers(nThreads);
+        std::atomic<unsigned int> nextJob(0);
+        std::vector<std::thread> threads;
+        for (auto const& worker: workers) {
+            threads.emplace_back([&, worker]() {
+                for (unsigned int iJob = nextJob++; iJob < jobs.size(); iJob = nextJob++)
+                    FitDelayedVertex(worker, *jobs[iJob]);
+            });
+        }
+        for (auto& thread: threads)
+            thread.join();
+    }
+
+    if (fFitCache.IsOpen()) {
+        for (auto const& job: jobs) {
+            // failed fits are fit again in later jobs
+            if (!job->isFitGood) continue;
+            FitCacheRecord record = {.key=job->cacheKey, .checkKey=job->checkKey,
+                                     .vertex={job->vertex.x(), job->vertex.y(), job->vertex.z()},
+                                     .time=job->fitTime, .goodness=job->goodness,
+                                     .aux={job->energy, job->dirKS, job->ovaQ}, .nHits=job->hitsForFit.GetSize()};
+            fFitCache.Add(record);
+        }
+    }
+}
+
+void EventNTagManager::FitDelayedVertex(VertexFitManager* fitter, DelayedVertexFit& fit)
+{
+    fitter->Fit(fit.hitsForFit);
+
+    // failed BONSAI fit: keep the default vertex and time, as for windows larger than BSNHITSMX
+    if ((fDelayedVertexMode == mBONSAI || fDelayedVertexMode == mLOWFIT)
+        && !static_cast<BonsaiManager*>(fitter)->IsFitGood())
+        return;
+
+    fit.isFitGood = true;
+    fit.vertex   = fitter->GetFitVertex();
+    fit.fitTime  = fitter->GetFitTime();
+    fit.time     = fit.fitTime + fit.timeOffset - 1000;
+    fit.goodness = fitter->GetFitGoodness();
+
+    if (fDelayedVertexMode == mBONSAI || fDelayedVertexMode == mLOWFIT) {
+        auto bonsaiManager = static_cast<BonsaiManager*>(fitter);
+        fit.energy = bonsaiManager->GetFitEnergy();
+        fit.dirKS  = bonsaiManager->GetFitDirKS();
+        fit.ovaQ   = bonsaiManager->GetFitOvaQ();
+    }
+}
+
+std::vector<VertexFitManager*> EventNTagManager::GetFitWorkers(unsigned int nWorkers)
+{
+    std::vector<VertexFitManager*> workers;
+
+    // TRMS-fit: copies of fTRMSFitManager with the current settings
+    if (fDelayedVertexMode == mTRMS) {
+        fTRMSFitWorkers.assign(nWorkers, fTRMSFitManager);
+        for (auto& worker: fTRMSFitWorkers) {
+            worker.SetVerbosity(pNONE);
+            workers.push_back(&worker);
+        }
+    }
 
-        if (doFit) {
-            hitsForFit.Sort();
-            fDelayedVertexManager->Fit(hitsForFit);
-            delayedVertex   = fDelayedVertexManager->GetFitVertex();
-            delayedTime     = fDelayedVertexManager->GetFitTime() + firstHit.t() - 1000;
-            delayedGoodness = fDelayedVertexManager->GetFitGoodness();
+    // goodness-fit: copies of fGoodnessFitManager with the current settings
+    else if (fDelayedVertexMode == mGOODNESS) {
+        fGoodnessFitWorkers.assign(nWorkers, fGoodnessFitManager);
+        for (auto& worker: fGoodnessFitWorkers) {
+            worker.SetVerbosity(pNONE);
+            workers.push_back(&worker);
         }
     }
 
+    // BONSAI: each worker keeps its own likelihood over candidates and events
+    else {
+        while (fBonsaiFitWorkers.size() < nWorkers) {
+            fBonsaiFitWorkers.emplace_back(new BonsaiManager(pNONE));
+            fBonsaiFitWorkers.back()->Initialize();
+        }
+        for (unsigned int iWorker=0; iWorker<nWorkers; iWorker++) {
+            fBonsaiFitWorkers[iWorker]->SetHitSelection(fSettings.GetInt("BSMAXNHITS", 0), fSettings.GetInt("BSTRMSNHITS", 0));
+            fBonsaiFitWorkers[iWorker]->SetTRMSParameters(fTRMSFitManager);
+            workers.push_back(fBonsaiFitWorkers[iWorker].get());
+        }
+    }
+
+    return workers;
+}
+
+void EventNTagManager::FindDelayedCandidate(const DelayedVertexFit& fit)
+{
+    PMTHit firstHit = fit.firstHit;
+    TVector3 delayedVertex = fit.vertex;
+    Float delayedTime = fit.time;
+
     //if (doFit || fSettings.GetBool("correct_tof")) {
     fEventHits.SetVertex(delayedVertex);
     firstHit.SetToFAndDirection(delayedVertex);
@@ -1170,12 +1418,12 @@ void EventNTagManager::FindDelayedCandidate(unsigned int iHit)
         unsigned int nHits = fEventHits.SliceRange(delayedTime, -TCANWIDTH/2.-0.03, TCANWIDTH/2.).GetSize();
 
         if (nHits >= MINNHITS && nHits <= MAXNHITS) {
-            Candidate candidate(iHit);
+            Candidate candidate(fit.iHit);
             candidate.Set("FitT", (delayedTime-1000)*1e-3); // -1000 ns is to offset the trigger time T=1000 ns
-            candidate.Set("FitGoodness", delayedGoodness);
-            candidate.Set("BSenergy", fBonsaiManager.GetFitEnergy());
-            candidate.Set("BSdirks", fBonsaiManager.GetFitDirKS());
-            candidate.Set("BSovaq", fBonsaiManager.GetFitOvaQ());
+            candidate.Set("FitGoodness", fit.goodness);
+            candidate.Set("BSenergy", fit.energy);
+            candidate.Set("BSdirks", fit.dirKS);
+            candidate.Set("BSovaq", fit.ovaQ);
             FindFeatures(candidate, delayedTime);
             fEventCandidates.Append(candidate);
         }
@@ -1299,6 +1547,17 @@ void EventNTagManager::Map(TaggableCluster& taggableCluster, CandidateCluster& c
 {
     std::string key = candidateCluster.GetName();
 
+    // distance to wall of taggables, found once for all candidates
+    unsigned int nTaggables = taggableCluster.GetSize();
+    std::vector<float> taggableX(nTaggables), taggableY(nTaggables), taggableZ(nTaggables), taggableDWall(nTaggables);
+    for (unsigned int iTaggable=0; iTaggable<nTaggables; iTaggable++) {
+        auto const& vertex = taggableCluster[iTaggable].Vertex();
+        taggableX[iTaggable] = vertex.x();
+        taggableY[iTaggable] = vertex.y();
+        taggableZ[iTaggable] = vertex.z();
+    }
+    SKGeometry::GetDWall(taggableX.data(), taggableY.data(), taggableZ.data(), taggableDWall.data(), nTaggables);
+
     for (unsigned int iCandidate=0; iCandidate<candidateCluster.GetSize(); iCandidate++) {
 
         auto& candidate = candidateCluster[iCandidate];
@@ -1319,7 +1578,7 @@ void EventNTagManager::Map(TaggableCluster& taggableCluster, CandidateCluster& c
         for (unsigned int iTaggable=0; iTaggable<taggableCluster.GetSize(); iTaggable++) {
             auto& taggable = taggableCluster[iTaggable];
             float tDiff = fabs(taggable.Time() - candidate["FitT"]);
-            if (tDiff*1e3 < tMatchWindow && GetDWall(taggable.Vertex())>0) {
+            if (tDiff*1e3 < tMatchWindow && taggableDWall[iTaggable]>0) {
                 matchTimeList.push_back(tDiff);
                 taggableIndexList.push_back(iTaggable);
             }
@@ -1409,26 +1668,16 @@ void EventNTagManager::FindReferenceRun()
         }
     }
 
-    int readStatus = SKIO::SetBadChannels(refRunNo, 0);
-
     // if bad channel list not found, search for closest noise run
-    if (!readStatus) {
-        int newRefRunNo = refRunNo;
-        int step = 1; int sign = 1;
-        while (!readStatus && step<100) {
-            newRefRunNo -= sign*step;
-            readStatus = SKIO::SetBadChannels(newRefRunNo, 0);
-            sign *= -1; step += 1;
-        }
-        if (step>=100) {
-            fMsg.Print(Form("Unable to fetch bad channel list for run %d", refRunNo), pERROR);
-        }
-        else {
-            fMsg.Print(Form("Unable to fetch bad channel list for run %d, "
-                            "fetching from the closest noise run %d...", refRunNo, newRefRunNo), pWARNING);
-        }
+    // (the search result and the tables are cached in SKIO)
+    int newRefRunNo = SKIO::FindNearestBadChannelRun(refRunNo);
+    if (!newRefRunNo) {
+        fMsg.Print(Form("Unable to fetch bad channel list for run %d", refRunNo), pERROR);
+    }
+    else if (newRefRunNo != refRunNo) {
+        fMsg.Print(Form("Unable to fetch bad channel list for run %d, "
+                        "fetching from the closest noise run %d...", refRunNo, newRefRunNo), pWARNING);
         refRunNo = newRefRunNo;
-        SKIO::SetBadChannels(refRunNo, 0);
     }
     SKIO::SetBadChannels(refRunNo);
 
@@ -1437,21 +1686,22 @@ void EventNTagManager::FindReferenceRun()
     int nBadIDPMTs = combad_.nbad;
     int nBadODPMTs = combada_.nbada;
 
-    std::vector<std::string> badTypes;
+    Printer hitMsg("NTagManager", fMsg.GetVerbosity(), cHITS);
+    if (!hitMsg.IsEnabled()) return;
+
+    std::string badTypes;
 
     int skbadopt = fSettings.GetInt("SKBADOPT", -1);
-    if (!skbadopt | skbadopt & (1<<0)) badTypes.push_back("bad");
-    if (!skbadopt | skbadopt & (1<<1)) badTypes.push_back("dead1");
-    if (!skbadopt | skbadopt & (1<<2)) badTypes.push_back("dead2");
-    if (!skbadopt | skbadopt & (1<<3)) badTypes.push_back("noisy");
-    if (!skbadopt | skbadopt & (1<<5)) badTypes.push_back("HK");
-
-    std::cout << "\n";
-    fMsg.Print(Form("BADSEL reference run: %d", fEventVariables.GetInt("RefRunNo")));
-    fMsg.Print(Form("# of bad ID PMTs: %d ( ", nBadIDPMTs), pDEFAULT, false);
-    for (auto const& btype: badTypes) std::cout << btype << " ";
-    std::cout << ")\n";
-    fMsg.Print(Form("# of bad OD PMTs: %d", nBadODPMTs));
+    if (!skbadopt | skbadopt & (1<<0)) badTypes += "bad ";
+    if (!skbadopt | skbadopt & (1<<1)) badTypes += "dead1 ";
+    if (!skbadopt | skbadopt & (1<<2)) badTypes += "dead2 ";
+    if (!skbadopt | skbadopt & (1<<3)) badTypes += "noisy ";
+    if (!skbadopt | skbadopt & (1<<5)) badTypes += "HK ";
+
+    Logger::Write(cHITS, "\n");
+    hitMsg.Print(Form("BADSEL reference run: %d", fEventVariables.GetInt("RefRunNo")));
+    hitMsg.Print(Form("# of bad ID PMTs: %d ( %s)", nBadIDPMTs, badTypes.c_str()));
+    hitMsg.Print(Form("# of bad OD PMTs: %d", nBadODPMTs));
 }
 
 void EventNTagManager::SetTaggedType(Taggable& taggable, Candidate& candidate)
@@ -1,6 +1,8 @@
 #ifndef EVENTNTAGMANAGER_HH
 #define EVENTNTAGMANAGER_HH
 
+#include <memory>
+
 #include "SKLibs.hh"
 #include "SKIO.hh"
 #include "PMTHitCluster.hh"
@@ -9,14 +11,41 @@
 #include "CandidateCluster.hh"
 #include "TRMSFitManager.hh"
 #include "BonsaiManager.hh"
+#include "GoodnessFitManager.hh"
 #include "NTagTMVAManager.hh"
 #include "NTagKerasManager.hh"
 #include "Printer.hh"
 #include "Store.hh"
 #include "NTagGlobal.hh"
+#include "FitCache.hh"
 
 class NoiseManager;
 
+/******************************************
+* @brief Delayed vertex fit of a candidate.
+*
+* @details Fit windows of all candidates in an event
+* are collected first, so that the fits can run
+* concurrently. See EventNTagManager::FitDelayedVertices.
+*******************************************/
+struct DelayedVertexFit
+{
+    unsigned int  iHit;       ///< Index of the first hit in the event hits
+    PMTHit        firstHit;   ///< First hit with prompt vertex ToF
+    PMTHitCluster hitsForFit; ///< Fit window, with \c timeOffset shifted to T=1000 ns
+    Float         timeOffset;
+    bool          doFit;
+    bool          isFitGood;  ///< \c true if the fit (or the fit cache) gave a vertex
+    uint64_t      cacheKey;   ///< See VertexFitManager::GetCacheKey
+    uint64_t      checkKey;
+
+    // results
+    TVector3 vertex;
+    Float    time;
+    float    fitTime;         ///< Fit time in the fit window
+    float    goodness, energy, dirKS, ovaQ;
+};
+
 class EventNTagManager
 {
     public:
@@ -68,7 +97,7 @@ class EventNTagManager
         void DumpSettings() { fSettings.Print(); }
         void DumpEvent();
         void DumpEventVariables();
-        void DumpHitReductionResults(std::vector<HitReductionResult> resVec);
+        void DumpHitReductionResults(const std::vector<HitReductionResult>& resVec);
 
         // getters
         Store& GetSettings() { return fSettings; };
@@ -110,7 +139,12 @@ class EventNTagManager
         void SetVertexMode(VertexMode& mode, std::string key);
 
         // delayed vertex fit and max hit search
-        void FindDelayedCandidate(unsigned int iHit);
+        void FindDelayedCandidates(const std::vector<unsigned int>& hitIDs);
+        void PrepareDelayedVertexFits(const std::vector<unsigned int>& hitIDs, std::vector<DelayedVertexFit>& fits);
+        void FitDelayedVertices(std::vector<DelayedVertexFit>& fits);
+        void FitDelayedVertex(VertexFitManager* fitter, DelayedVertexFit& fit);
+        std::vector<VertexFitManager*> GetFitWorkers(unsigned int nWorkers);
+        void FindDelayedCandidate(const DelayedVertexFit& fit);
 
         // feature extraction
         void FindFeatures(Candidate& candidate, Float canTime);
@@ -151,6 +185,7 @@ class EventNTagManager
         Float T0TH, T0MX, TWIDTH, TCANWIDTH, TMINPEAKSEP, TMATCHWINDOW, TRBNWIDTH, PMTDEADTIME;
         int NHITSTH, NHITSMX, N200TH, N200MX, MINNHITS, MAXNHITS;
         float QMAX;
+        int BSNHITSMX;
         float TRMSTWIDTH, INITGRIDWIDTH, MINGRIDWIDTH, GRIDSHRINKRATE, VTXMAXRADIUS;
         float E_NHITSCUT, E_TIMECUT, TAGOUTCUT;
         float SCINTCUT, GOODNESSCUT, DIRKSCUT, DISTCUT, ECUT;
@@ -159,6 +194,16 @@ class EventNTagManager
         VertexFitManager* fDelayedVertexManager;
         TRMSFitManager fTRMSFitManager;
         BonsaiManager fBonsaiManager;
+        GoodnessFitManager fGoodnessFitManager;
+
+        // per-thread copies of the delayed vertex fitter
+        unsigned int FITTHREADS;
+        std::vector<TRMSFitManager> fTRMSFitWorkers;
+        std::vector<std::unique_ptr<BonsaiManager>> fBonsaiFitWorkers;
+        std::vector<GoodnessFitManager> fGoodnessFitWorkers;
+
+        // delayed vertex fit results from previous jobs
+        FitCache fFitCache;
 
         // TMVA
         NTagTMVAManager fTMVAManager;
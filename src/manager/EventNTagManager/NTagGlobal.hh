@@ -6,7 +6,7 @@
 
 enum VertexMode
 {
-    mNONE, mAPFIT, mBONSAI, mFITQUN, mCUSTOM, mTRUE, mSTMU, mTRMS, mPROMPT, mLOWFIT
+    mNONE, mAPFIT, mBONSAI, mFITQUN, mCUSTOM, mTRUE, mSTMU, mTRMS, mPROMPT, mLOWFIT, mGOODNESS
 };
 
 enum TriggerType
@@ -52,17 +52,22 @@ static std::vector<std::string> gKerasFeatures = {"NHits", "NResHits", "TRMS",
                                                   "BurstRatio", "FitGoodness", "DarkLikelihood"};
 
 static std::vector<std::string> gCmdOptions = {"force_flat", "outdata", "write_bank", "noise_path", "noise_type", "save_hits",
-                                               "add_noise", "repeat_noise", "in_noise", "dump_noise", "IDDARKRATE", "ODDARKRATE",
+                                               "add_noise", "repeat_noise", "in_noise", "dump_noise", "noise_bank", "noise_catalog",
+                                               "catalog_entries", "noise_prefetch", "nshards", "shard", "reapply_trigger", "check_trigger",
+                                               "noise_rate_scale", "noise_target_rate", "IDDARKRATE", "ODDARKRATE",
                                                "noise_cut", "PMTDEADTIME", "IDMAXN200", "ODMAXN200", "TGATEMIN", "TGATEMAX",
                                                "weight", "debug", "in", "out", "NN_type", "correct_tof", "macro",
-                                               "prompt_vertex", "delayed_vertex", "vx", "vy", "vz", "tag_e",
+                                               "prompt_vertex", "delayed_vertex", "fit_threads", "fit_cache", "vx", "vy", "vz", "tag_e",
                                                "SKGEOMETRY", "SKOPTN", "SKBADOPT", "REFRUNNO", "lowfit_param",
                                                "QMAX", "TMIN", "TMAX", "TRBNWIDTH", "PVXRES", "PVXBIAS", "NIDHITMX", "NODHITMX",
-                                               "TNOISESTART", "TNOISEEND", "NOISESEED",
+                                               "TNOISESTART", "TNOISEEND", "NOISESEED", "NOISEQMEAN", "NOISEQSIGMA",
+                                               "noise_charge", "noise_dark_rate", "noise_event_seed",
                                                "TWIDTH", "NHITSTH", "NHITSMX", "N200MX", "TCANWIDTH", "MINNHITS", "MAXNHITS",
                                                "TMINPEAKSEP", "TMATCHWINDOW",
                                                "TRMSTWIDTH", "INITGRIDWIDTH", "MINGRIDWIDTH", "GRIDSHRINKRATE", "VTXMAXRADIUS",
+                                               "trms_fit", "trms_start", "STARTRADIUS", "MINSTEPWIDTH",
+                                               "BSNHITSMX", "BSMAXNHITS", "BSTRMSNHITS",
                                                "E_CUTS", "N_CUTS",
-                                               "print", "commit", "tag", "mode"};
+                                               "print", "fortran_log", "log", "log_rate", "log_async", "commit", "tag", "mode"};
 
 #endif
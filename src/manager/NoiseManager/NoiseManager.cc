@@ -1,6 +1,10 @@
 #include <fstream>
+#include <sstream>
+#include <map>
 
 #include <TROOT.h>
+#include <RVersion.h>
+#include <TThread.h>
 #include <TF1.h>
 #include <TH1F.h>
 #include <TFile.h>
@@ -11,8 +15,10 @@
 #include <TChain.h>
 #include <TChainElement.h>
 #include <TRandom3.h>
+#include <TSystem.h>
 
 #include <tqrealroot.h>
+#include <skbadcC.h>
 #undef MAXPM
 #undef MAXPMA
 
@@ -20,10 +26,67 @@
 #include <SKIO.hh>
 #include "NoiseManager.hh"
 
+// mixes a base seed and an event index into a nonzero TRandom3 seed
+static unsigned int MixSeed(unsigned int seed, unsigned int eventID, bool OD)
+{
+    unsigned long long x = ((unsigned long long)seed << 32) ^ ((unsigned long long)eventID << 1) ^ OD;
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    x ^= (x >> 31);
+    unsigned int mixed = (unsigned int)(x ^ (x >> 32));
+    return mixed ? mixed : 1;
+}
+
+static bool IsNoiseTrigger(int trgType)
+{
+    return trgType & mRandomWide || trgType == mT2KDummy || trgType & mNickel;
+}
+
+// maximum number of hits in 200 ns bins within [-500, 500] usec
+static int GetMaxN200(const std::vector<float>& t)
+{
+    int maxN200 = 0;
+    for (auto const& bin: Histogram(t, 5000, -500e3, 500e3))
+        maxN200 = std::max(maxN200, bin.second);
+    return maxN200;
+}
+
+// option: <base>, <base>:<run>, or <base>:<min run>-<max run>
+static void ParseNoiseOption(TString option, TString& base, TString& run, int& minRun, int& maxRun)
+{
+    TObjArray* opt = option.Tokenize(':');
+    base = ((TObjString*)(opt->At(0)))->GetString();
+    run = "";
+    minRun = -1;
+    maxRun = 1000000;
+    if (option.Contains(":")) {
+        run = "0" + ((TObjString*)(opt->At(1)))->GetString();
+        if (run.Contains("-")) {
+            TObjArray* runRange = run.Tokenize('-');
+            minRun = ((TObjString*)(runRange->At(0)))->GetString().Atoi();
+            maxRun = ((TObjString*)(runRange->At(1)))->GetString().Atoi();
+            run = "";
+        }
+    }
+}
+
+// one noise file in a noise catalog
+struct NoiseFileRecord
+{
+    TString path;
+    int run;
+    long nEntries, nSelected;
+    bool hasEntryList;
+    std::vector<long> selectedEntries;
+};
+
 NoiseManager::NoiseManager()
 : fNoiseTree(0), fNoiseTreeName("data"),
   fNoisePath("/disk02/calib3/usr/han/dummy"), fNoiseType("sk6"),
   fNoiseCut(Form("HEADER.idtgsk & %d || HEADER.idtgsk == %d || HEADER.idtgsk & %d", mRandomWide, mT2KDummy, mNickel)),
+  fHeader(0), fIDTQReal(0), fODTQReal(0),
+  fCurrentRun(0), fCurrentSubrun(0), fCurrentEventID(0),
   fSKGen(6),
   fNoiseSeed(0),
   fNoiseEventLength(1000e3),
@@ -39,6 +102,11 @@ NoiseManager::NoiseManager()
   fPartID(0), fNParts(2),
   fCurrentPartStartTime(-1000e3), fCurrentPartEndTime(1000e3),
 	fDoRepeat(true), fDoN200Cut(false), fDoRandomizeFirstEntry(true), fRandomizedFirstEntry(-1),
+  fChargeModel(mGausCharge), fChargeMean(1), fChargeSigma(0.7),
+  fDoSeedPerEvent(false), fEventSeed(1),
+  fEventIndex(0), fPickedEventIndex(-1),
+  fRateScale(1), fTargetIDDarkRatekHz(0), fNoiseEventIDDarkRatekHz(0), fExtraPartID(-1),
+  fReadEntry(-2), fMaxQueueSize(0), fDoStopReader(false),
   fMsg("NoiseManager")
 {}
 
@@ -50,6 +118,7 @@ NoiseManager::NoiseManager(TChain* tree)
 
 NoiseManager::~NoiseManager()
 {
+    StopNoiseReader();
     if (fNoiseTree) delete fNoiseTree;
 }
 
@@ -65,22 +134,38 @@ void NoiseManager::DumpSettings()
 {
     fMsg.PrintBlock("NoiseManager settings");
 
-    if (fNoiseTree) {
+    if (fNoiseTree || fNoiseBank.IsOpen()) {
         fMsg.Print(Form("Noise type: " + fNoiseType));
-        fMsg.Print(Form("Total dummy trigger entries: %d", fNoiseTree->GetEntries(fNoiseCut)));
+        if (fNoiseBank.IsOpen())
+            fMsg.Print(Form("Total dummy trigger entries: %d (noise bank)", fNoiseBank.GetNEntries()));
+        else if (!fNoiseEntryList.empty())
+            fMsg.Print(Form("Total dummy trigger entries: %d (noise catalog)", fNEntries));
+        else
+            fMsg.Print(Form("Total dummy trigger entries: %d", fNoiseTree->GetEntries(fNoiseCut)));
 		fMsg.Print(Form("Randomized starting entry? : %s", (fDoRandomizeFirstEntry ? "yes" : "no")));
 		fMsg.Print(Form("Dummy trgger starting entry: %d", (fRandomizedFirstEntry == -1 ? 0 : fRandomizedFirstEntry)));
         fMsg.Print(Form("Repetition allowed? %s", (fDoRepeat ? "yes" : "no")));
+        fMsg.Print(Form("Prefetched noise events: %u", fMaxQueueSize));
+        if (fTargetIDDarkRatekHz > 0)
+            fMsg.Print(Form("Noise rate scaled to ID dark rate %3.2f kHz", fTargetIDDarkRatekHz));
+        else if (fRateScale != 1)
+            fMsg.Print(Form("Noise rate scale: %3.2f", fRateScale));
         if (fDoN200Cut) fMsg.Print(Form("Noise MaxN200: %d (ID), %d (OD)", fIDMaxN200, fODMaxN200));
     }
     else {
-        fMsg.Print(Form("ID dark rate: %3.2f kHz", fIDDarkRatekHz));
+        if (fIDPMTDarkRatekHz.empty())
+            fMsg.Print(Form("ID dark rate: %3.2f kHz", fIDDarkRatekHz));
+        else
+            fMsg.Print(Form("ID dark rate: per-PMT (%lu PMTs)", fIDPMTDarkRatekHz.size()));
         fMsg.Print(Form("OD dark rate: %3.2f kHz", fODDarkRatekHz));
+        const char* chargeModelName[] = {"gaus", "exp", "unit"};
+        fMsg.Print(Form("Charge model: %s (mean %3.2f p.e., sigma %3.2f p.e.)",
+                        chargeModelName[fChargeModel], fChargeMean, fChargeSigma));
     }
     fMsg.Print(Form("Noise range: [%3.2f, %3.2f] usec (T_trigger=0)", fNoiseStartTime*1e-3-1, fNoiseEndTime*1e-3-1));
     fMsg.Print(Form("Seed: %d", fNoiseSeed));
-    fMsg.Print(Form("PMT deadtime: %3.2f ns", fPMTDeadtime));
-    std::cout << "\n";
+    if (fDoSeedPerEvent) fMsg.Print(Form("Per-event noise from (seed %u, event index)", fEventSeed));
+    fMsg.Print(Form("PMT deadtime: %3.2f ns\n", fPMTDeadtime));
 }
 
 void NoiseManager::AddNoiseFileToChain(TChain* chain, TString noiseFilePath)
@@ -114,13 +199,14 @@ void NoiseManager::SetNoiseTree(TChain* tree)
     fODTQReal = 0; fNoiseTree->SetBranchAddress("TQAREAL", &fODTQReal);
     fHeader = 0; fNoiseTree->SetBranchAddress("HEADER", &fHeader);
     fNEntries = fNoiseTree->GetEntries();
+    if (!fNoiseEntryList.empty()) fNEntries = fNoiseEntryList.size();
 
 	if (fDoRandomizeFirstEntry == true)
 	{
 	    auto random = ranGen.Uniform();
 	    long randomized_ent = (long) ((double)ceil(fNEntries*random));
 		fRandomizedFirstEntry = randomized_ent-1;
-		int ret = fNoiseTree->GetEntry(fRandomizedFirstEntry);
+		int ret = fNoiseTree->GetEntry(GetTreeEntry(fRandomizedFirstEntry));
 		//fMsg.Print(Form("Randomize TChain starting entry: %d", fDoRandomizeFirstEntry));
 		//fMsg.Print(Form("             Total TChain entry: %d", fNEntries));
 		//fMsg.Print(Form("          TChain starting entry: %d", fNoiseTree->GetReadEntry()));
@@ -164,6 +250,52 @@ void NoiseManager::DumpNoiseFileList(TString pathToList)
     outFile.close();
 }
 
+void NoiseManager::DumpNoiseBank(TString pathToBank)
+{
+    NoiseBankWriter writer;
+    if (!writer.Open(pathToBank.Data()))
+        fMsg.Print("Could not open noise bank " + pathToBank + " for writing!", pERROR);
+
+    for (int iEntry=0; iEntry<fNEntries; iEntry++) {
+        fNoiseTree->GetEntry(GetTreeEntry(iEntry));
+        if (!IsNoiseTrigger(fHeader->idtgsk) || !fIDTQReal->nhits || !fODTQReal->nhits) continue;
+
+        fIDNoiseEventHits.Clear(); fODNoiseEventHits.Clear();
+        PopulateHitCluster(&fIDNoiseEventHits);
+        PopulateHitCluster(&fODNoiseEventHits, true);
+        if (fIDNoiseEventHits.IsEmpty() || fODNoiseEventHits.IsEmpty()) continue;
+
+        NoiseBankEntry entry = {};
+        entry.run       = fHeader->nrunsk;
+        entry.subrun    = fHeader->nsubsk;
+        entry.event     = fHeader->nevsk;
+        entry.trigger   = fHeader->idtgsk;
+        entry.minT      = std::max(fIDNoiseEventHits.First().t(), fODNoiseEventHits.First().t());
+        entry.maxT      = std::min(fIDNoiseEventHits.Last().t(), fODNoiseEventHits.Last().t());
+        entry.idMaxN200 = GetMaxN200(fIDTQReal->T);
+        entry.odMaxN200 = GetMaxN200(fODTQReal->T);
+        writer.AddEntry(entry, fIDNoiseEventHits, fODNoiseEventHits);
+    }
+
+    if (!writer.Close())
+        fMsg.Print("Failed writing noise bank " + pathToBank + "!", pERROR);
+    fMsg.Print(Form("Wrote %d dummy trigger entries to noise bank ", writer.GetNEntries()) + pathToBank);
+}
+
+void NoiseManager::SetNoiseBank(TString pathToBank)
+{
+    if (!fNoiseBank.Open(pathToBank.Data()))
+        fMsg.Print("Could not open noise bank " + pathToBank + "!", pERROR);
+
+    fNoiseType = "bank";
+    fNEntries = fNoiseBank.GetNEntries();
+    if (!fNEntries)
+        fMsg.Print("Empty noise bank " + pathToBank + "!", pERROR);
+
+    if (fDoRandomizeFirstEntry)
+        fRandomizedFirstEntry = (long)ceil(fNEntries*ranGen.Uniform()) - 1;
+}
+
 void NoiseManager::SetNoiseTreeFromOptions(TString option, int nInputEvents, float tStart, float tEnd, int seed)
 {
     fNoiseType = option;
@@ -172,20 +304,9 @@ void NoiseManager::SetNoiseTreeFromOptions(TString option, int nInputEvents, flo
     // Read dummy (TChain)
     TChain* dummyChain = new TChain(fNoiseTreeName);
 
-    TObjArray* opt = option.Tokenize(':');
-    TString base = ((TObjString*)(opt->At(0)))->GetString();
-    TString run = "";
-    int minRun = -1;
-    int maxRun = 1000000;
-    if (option.Contains(":")) {
-        run = "0" + ((TObjString*)(opt->At(1)))->GetString();
-        if (run.Contains("-")) {
-            TObjArray* runRange = run.Tokenize('-');
-            minRun = ((TObjString*)(runRange->At(0)))->GetString().Atoi();
-            maxRun = ((TObjString*)(runRange->At(1)))->GetString().Atoi();
-            run = "";
-        }
-    }
+    TString base, run;
+    int minRun, maxRun;
+    ParseNoiseOption(option, base, run, minRun, maxRun);
 
     SetSeed(seed);
     TString dummyRunPath = fNoisePath + "/" + option;
@@ -233,6 +354,153 @@ void NoiseManager::SetNoiseTreeFromOptions(TString option, int nInputEvents, flo
     SetNoiseTree(dummyChain);
 }
 
+void NoiseManager::DumpNoiseCatalog(TString noiseType, TString pathToCatalog, bool doSaveEntryList)
+{
+    if (noiseType == "default") noiseType = "sk" + std::to_string(fSKGen);
+    TString noiseDir = fNoisePath + "/" + noiseType;
+
+    std::ofstream outFile;
+    outFile.open(pathToCatalog.Data(), std::ios::out);
+    outFile << "# NTag noise catalog of " << noiseDir << "\n";
+    outFile << "# <file path> <run> <entries> <selected entries> [: <selected entry numbers>]\n";
+
+    int nFiles = 0; long nSelectedTotal = 0;
+    for (auto const& runDir: GetListOfSubdirectories(noiseDir)) {
+        int runNo = ((TObjString*)((runDir.Tokenize('/'))->Last()))->GetString().Atoi();
+        if (!runNo) continue; // skip any non-numeric run directory name
+
+        for (auto const& filePath: GetListOfFiles(runDir, ".root")) {
+            TFile* file = TFile::Open(filePath);
+            TTree* tree = file ? (TTree*)(file->Get(fNoiseTreeName)) : 0;
+            if (!tree) {
+                fMsg.Print("Skipping " + filePath + " with no noise tree...", pWARNING);
+                if (file) file->Close();
+                continue;
+            }
+
+            // read trigger type only
+            Header* header = 0;
+            tree->SetBranchStatus("*", 0);
+            tree->SetBranchStatus("HEADER*", 1);
+            tree->SetBranchAddress("HEADER", &header);
+
+            long nEntries = tree->GetEntries();
+            std::vector<long> selectedEntries;
+            for (long iEntry=0; iEntry<nEntries; iEntry++) {
+                tree->GetEntry(iEntry);
+                if (IsNoiseTrigger(header->idtgsk)) selectedEntries.push_back(iEntry);
+            }
+            file->Close();
+            delete header;
+
+            outFile << filePath << " " << runNo << " " << nEntries << " " << selectedEntries.size();
+            if (doSaveEntryList) {
+                outFile << " :";
+                for (auto const& iEntry: selectedEntries) outFile << " " << iEntry;
+            }
+            outFile << "\n";
+
+            nFiles++; nSelectedTotal += selectedEntries.size();
+        }
+    }
+
+    outFile.close();
+    fMsg.Print(Form("Wrote %d noise files with %ld dummy trigger entries to noise catalog ", nFiles, nSelectedTotal)
+               + pathToCatalog);
+}
+
+void NoiseManager::SetNoiseTreeFromCatalog(TString pathToCatalog, TString option, int nInputEvents, float tStart, float tEnd, int seed)
+{
+    fNoiseType = option;
+    SetNoiseTimeRange(tStart, tEnd);
+
+    TString base, run;
+    int minRun, maxRun;
+    ParseNoiseOption(option, base, run, minRun, maxRun);
+    int runNo = run.Atoi();
+
+    // read in files in the requested run (range)
+    std::ifstream inFile;
+    inFile.open(pathToCatalog.Data());
+    if (!inFile.is_open())
+        fMsg.Print("Could not open noise catalog " + pathToCatalog + "!", pERROR);
+
+    std::vector<NoiseFileRecord> records;
+    std::map<int, std::vector<unsigned int>> recordsByRun;
+    std::string line;
+    while (std::getline(inFile, line)) {
+        if (line.empty() || line[0] == '#') continue;
+
+        std::istringstream lineStream(line);
+        std::string filePath, separator;
+        NoiseFileRecord record;
+        lineStream >> filePath >> record.run >> record.nEntries >> record.nSelected;
+        record.path = filePath;
+        record.hasEntryList = bool(lineStream >> separator) && separator == ":";
+        long iEntry;
+        while (lineStream >> iEntry) record.selectedEntries.push_back(iEntry);
+
+        bool isInRange = runNo ? record.run == runNo : (minRun <= record.run && record.run <= maxRun);
+        if (!record.nSelected || !isInRange) continue;
+
+        recordsByRun[record.run].push_back(records.size());
+        records.push_back(record);
+    }
+    inFile.close();
+
+    if (recordsByRun.empty())
+        fMsg.Print("No noise files for " + option + " in noise catalog " + pathToCatalog + "!", pERROR);
+
+    std::vector<int> runs;
+    for (auto const& pair: recordsByRun) runs.push_back(pair.first);
+
+    // pick random runs and files as in SetNoiseTreeFromOptions, without listing the noise directory
+    SetSeed(seed);
+    int nRequiredEvents = nInputEvents / fNParts;
+    TChain* dummyChain = new TChain(fNoiseTreeName);
+    std::vector<bool> isUsed(records.size(), false);
+    std::vector<long> entryList;
+    bool hasEntryLists = true;
+    long chainOffset = 0;
+
+    int nTrial = 0;
+    while (fNEntries <= nRequiredEvents) {
+
+        // limit the number of iterations
+        nTrial++;
+        if (nTrial > 10000) {
+            std::cerr << "Could not find enough noise files within iteration limit 10000, aborting...\n";
+            abort();
+        }
+
+        unsigned int iRecord = PickRandom(recordsByRun[PickRandom(runs)]);
+        if (isUsed[iRecord]) continue;
+        isUsed[iRecord] = true;
+
+        // only picked files are checked, so that the catalog is read without touching the noise directory;
+        // relative paths are relative to the working directory
+        auto const& record = records[iRecord];
+        if (gSystem->AccessPathName(record.path)) {
+            fMsg.Print("Noise file " + record.path + " in noise catalog " + pathToCatalog
+                       + " does not exist, skipping...", pWARNING);
+            continue;
+        }
+
+        fMsg.Print(Form("Adding dummy file at ") + record.path + Form(": %ld entries", record.nSelected));
+        dummyChain->Add(record.path, record.nEntries); // known number of entries: file is not opened here
+
+        hasEntryLists &= record.hasEntryList;
+        for (auto const& iEntry: record.selectedEntries) entryList.push_back(chainOffset + iEntry);
+        chainOffset += record.nEntries;
+        fNEntries += record.nSelected;
+    }
+
+    // entry list is used only if every added file has one
+    if (hasEntryLists) fNoiseEntryList = entryList;
+
+    SetNoiseTree(dummyChain);
+}
+
 void NoiseManager::SetNoiseTreeFromList(TString pathToList)
 {
     std::ifstream inFile;
@@ -280,13 +548,15 @@ void NoiseManager::ApplySettings(Store& settings, int nInputEvents)
 {
     auto skGen       = SKIO::GetSKGeometry();
     auto noiseType   = settings.GetString("noise_type");
-    auto idDarkRate  = settings.GetFloat("IDDARKRATE");
-    auto odDarkRate  = settings.GetFloat("ODDARKRATE");
+    auto idDarkRate  = settings.GetFloat("IDDARKRATE", 7.5);
+    auto odDarkRate  = settings.GetFloat("ODDARKRATE", 4.0);
     auto doN200Cut   = settings.GetBool("noise_cut", false);
     auto idMaxN200   = settings.GetInt("IDMAXN200", 60);
     auto odMaxN200   = settings.GetInt("ODMAXN200", 20);
     auto inputNoise  = settings.GetString("in_noise");
     auto noiseList   = settings.GetString("dump_noise");
+    auto noiseBank   = settings.GetString("noise_bank");
+    auto noiseCatalog = settings.GetString("noise_catalog");
     auto tNoiseStart = settings.GetFloat("TNOISESTART", 0);
     auto tNoiseEnd   = settings.GetFloat("TNOISEEND", 535);
     auto noiseSeed   = settings.GetInt("NOISESEED");
@@ -294,15 +564,42 @@ void NoiseManager::ApplySettings(Store& settings, int nInputEvents)
     float pmtDeadtime = 900;
     auto debug       = settings.GetBool("debug", false);
 	auto randomizeNoise = settings.GetBool("RANDOMIZENOISE", true);
+    auto chargeModel = settings.GetString("noise_charge", "gaus");
+    auto darkRateType = settings.GetString("noise_dark_rate", "flat");
 
     SetSKGeneration(skGen);
     SetSeed(noiseSeed);
     SetNoiseMaxN200(idMaxN200, odMaxN200, doN200Cut);
     SetPMTDeadtime(pmtDeadtime);
 	SetRandomizeFirstEntry(randomizeNoise);
+    SetPrefetch(settings.GetInt("noise_prefetch", 0));
+    SetRateScale(settings.GetFloat("noise_rate_scale", 1), settings.GetFloat("noise_target_rate", 0));
     if (debug) SetVerbosity(pDEBUG);
+
+    // NOISESEED 0 seeds ranGen with time, so draw the base seed from it
+    SetEventSeeding(settings.GetBool("noise_event_seed", false),
+                    noiseSeed ? noiseSeed : 1 + ranGen.Integer(2147483646));
+
     if (noiseType == "simulate") {
         SetDarkRate(idDarkRate, odDarkRate);
+        SetNoiseTimeRange(tNoiseStart, tNoiseEnd);
+
+        NoiseChargeModel model = mGausCharge;
+        if      (chargeModel == "exp")  model = mExpCharge;
+        else if (chargeModel == "unit") model = mUnitCharge;
+        else if (chargeModel != "gaus")
+            fMsg.Print(Form("Unknown noise charge model %s, using gaus...", chargeModel.c_str()), pWARNING);
+        SetChargeModel(model, settings.GetFloat("NOISEQMEAN", 1), settings.GetFloat("NOISEQSIGMA", 0.7));
+
+        if (darkRateType == "pmt")
+            LoadPMTDarkRates(SKIO::GetRefRunNo());
+        else if (darkRateType != "flat")
+            fMsg.Print(Form("Unknown noise dark rate type %s, using flat rates...", darkRateType.c_str()), pWARNING);
+    }
+    else if (!noiseBank.empty()) {
+        SetNoiseTimeRange(tNoiseStart, tNoiseEnd);
+        SetNoiseBank(noiseBank);
+        SetRepeat(settings.GetBool("repeat_noise", true));
     }
     else {
         if (!inputNoise.empty()) {
@@ -311,6 +608,9 @@ void NoiseManager::ApplySettings(Store& settings, int nInputEvents)
             else
                 SetNoiseTreeFromList(inputNoise);
         }
+        else if (!noiseCatalog.empty()) {
+            SetNoiseTreeFromCatalog(noiseCatalog, noiseType, nInputEvents, tNoiseStart, tNoiseEnd, noiseSeed);
+        }
         else {
             SetNoisePath(settings.GetString("noise_path"));
             SetNoiseTreeFromOptions(noiseType, nInputEvents, tNoiseStart, tNoiseEnd, noiseSeed);
@@ -328,87 +628,307 @@ void NoiseManager::GetNextNoiseEvent()
 {
     fPartID = 0; fCurrentIDHitIndex = 0; fCurrentODHitIndex = 0;
 
-    fCurrentEntry++; fIDNoiseEventHits.Clear(); fODNoiseEventHits.Clear();
-    if (fCurrentEntry < fNEntries) {
-        fNoiseTree->GetEntry(fCurrentEntry);
-        int trgType = fHeader->idtgsk;
-        if (trgType & mRandomWide || trgType == mT2KDummy || trgType & mNickel)
-            SetNoiseEventHits();
-        else
-            GetNextNoiseEvent();
-    }
-    else {
-        fMsg.Print("Noise tree reached its end!", pWARNING);
-        if (fCurrentEntry == fNEntries && fDoRepeat) {
-            // start from beginning
-            fMsg.Print("Repetition allowed: going back to the first entry in noise tree...", pWARNING);
-            fCurrentEntry = -1;
-            GetNextNoiseEvent();
-            //fNoiseTree->GetEntry(fCurrentEntry);
+    NoiseEvent noiseEvent;
+    TakeNoiseEvent(noiseEvent);
+
+    // random numbers are drawn here in consumption order, so that the noise sequence is fixed by the seed
+    UseNoiseEvent(noiseEvent, ranGen);
+}
+
+void NoiseManager::PickNoiseEvent()
+{
+    // entry, part and offset depend only on (seed, event index)
+    fEventRanGen.SetSeed(MixSeed(fEventSeed, fEventIndex, false));
+    fReadEntry = fEventRanGen.Integer(fNEntries) - 1;
+
+    NoiseEvent noiseEvent;
+    ReadNoiseEvent(noiseEvent);
+    UseNoiseEvent(noiseEvent, fEventRanGen);
+
+    fPartID = fEventRanGen.Integer(fNParts);
+    fCurrentIDHitIndex = 0; fCurrentODHitIndex = 0;
+    fPickedEventIndex = fEventIndex;
+}
+
+void NoiseManager::UseNoiseEvent(NoiseEvent& noiseEvent, TRandom3& rng)
+{
+    PrintNoiseEventMessages(noiseEvent);
+
+    fCurrentEntry = noiseEvent.entry;
+    fCurrentRun = noiseEvent.run; fCurrentSubrun = noiseEvent.subrun; fCurrentEventID = noiseEvent.event;
+
+    fNoiseEventMinT = noiseEvent.minT; fNoiseEventMaxT = noiseEvent.maxT;
+    fNoiseEventLength = fNoiseEventMaxT - fNoiseEventMinT;
+    fNParts = (int)(fNoiseEventLength / fNoiseWindowWidth);
+
+    if (fTargetIDDarkRatekHz > 0)
+        fNoiseEventIDDarkRatekHz = GetIDDarkRatekHz(noiseEvent);
+
+    fIDNoiseEventHits = std::move(noiseEvent.idHits);
+    fODNoiseEventHits = std::move(noiseEvent.odHits);
+
+    auto random = rng.Uniform();
+    fNoiseT0 = fNoiseEventMinT + (fNoiseEventLength - fNParts*fNoiseWindowWidth)*random;
+
+    fExtraNoiseEvents.clear(); fExtraKeepProbs.clear(); fExtraODKeepProbs.clear();
+    fExtraPartID = -1;
+    if (GetNoiseRateScale() > 1 || GetNoiseRateScale(true) > 1)
+        PrepareExtraNoiseEvents(rng);
+}
+
+void NoiseManager::PrintNoiseEventMessages(const NoiseEvent& noiseEvent)
+{
+    for (auto const& warning: noiseEvent.warnings)
+        fMsg.Print(warning, pWARNING);
+    if (!noiseEvent.isValid)
+        fMsg.Print(noiseEvent.error + " Aborting program...", pERROR);
+}
+
+float NoiseManager::GetIDDarkRatekHz(const NoiseEvent& noiseEvent)
+{
+    // mean over live ID PMTs of the noise run, including those without hits in the event
+    float minT = noiseEvent.minT, maxT = noiseEvent.maxT;
+    unsigned int nHits = 0;
+    for (auto const& hit: noiseEvent.idHits)
+        if (minT <= hit.t() && hit.t() <= maxT && hit.i() <= MAXPM) nHits++;
+
+    int nLivePMTs = GetNLiveIDPMTs(noiseEvent.run, noiseEvent.subrun);
+    return (nLivePMTs > 0 && maxT > minT) ? nHits / (nLivePMTs * (maxT - minT)) * 1e6 : 0;
+}
+
+int NoiseManager::GetNLiveIDPMTs(int runNo, int subrunNo)
+{
+    auto key = std::make_pair(runNo, subrunNo);
+    auto cached = fNLiveIDPMTs.find(key);
+    if (cached != fNLiveIDPMTs.end())
+        return cached->second;
+
+    // the read below replaces the global bad channel tables of the signal
+    int prevRunNo = SKIO::GetBadChRunNo();
+    int prevSubrunNo = SKIO::GetBadChSubrunNo();
+
+    int nLivePMTs = MAXPM - combad_.nbad;
+    if (SKIO::SetBadChannels(runNo, subrunNo))
+        nLivePMTs = MAXPM - combad_.nbad;
+    else
+        fMsg.Print(Form("Could not read bad channels of noise run %d subrun %d, "
+                        "counting the current bad channels as dead to measure its ID dark rate...", runNo, subrunNo), pWARNING);
+
+    // restore the tables in use before (from the SKIO cache)
+    if (prevRunNo) SKIO::SetBadChannels(prevRunNo, prevSubrunNo);
+    else           SKIO::ResetBadChannels();
+
+    fNLiveIDPMTs[key] = nLivePMTs;
+    return nLivePMTs;
+}
+
+void NoiseManager::PrepareExtraNoiseEvents(TRandom3& rng)
+{
+    // superposed noise is taken from other dummy trigger events,
+    // so that it is not correlated with the noise of the main part
+    bool isTargetRate = fTargetIDDarkRatekHz > 0 && fNoiseEventIDDarkRatekHz > 0;
+
+    // rate to add, relative to the rate of the current noise event
+    float missingRate = GetNoiseRateScale() - 1;
+    float missingODRate = GetNoiseRateScale(true) - 1;
+    int nTrials = 0;
+
+    while (missingRate > 1e-3 || missingODRate > 1e-3) {
+        if (nTrials++ > fNEntries)
+            fMsg.Print("Could not find noise events to superpose in the whole noise tree! Aborting program...", pERROR);
+
+        fExtraNoiseEvents.emplace_back();
+        NoiseEvent& extraEvent = fExtraNoiseEvents.back();
+        if (fDoSeedPerEvent) {
+            fReadEntry = rng.Integer(fNEntries) - 1;
+            ReadNoiseEvent(extraEvent);
         }
-        else {
-            // error
-            fMsg.Print("Repetition disallowed. To allow, use NoiseManager::SetRepeat(true). Aborting program...", pERROR);
+        else TakeNoiseEvent(extraEvent);
+        PrintNoiseEventMessages(extraEvent);
+
+        float rate = !isTargetRate ? 1 :
+                     GetIDDarkRatekHz(extraEvent) / fNoiseEventIDDarkRatekHz;
+        if (rate <= 0) {
+            fExtraNoiseEvents.pop_back();
+            continue;
         }
+
+        // the last event is thinned to the remaining rate
+        float keepProb = std::max(0.f, std::min(1.f, missingRate / rate));
+        fExtraKeepProbs.push_back(keepProb);
+        missingRate -= keepProb * rate;
+
+        // OD rates are not measured: each event adds the OD rate of the current one
+        float odKeepProb = std::max(0.f, std::min(1.f, missingODRate));
+        fExtraODKeepProbs.push_back(odKeepProb);
+        missingODRate -= odKeepProb;
     }
 }
 
-void NoiseManager::SetNoiseEventHits()
+void NoiseManager::TakeNoiseEvent(NoiseEvent& noiseEvent)
 {
-    bool useThisNoiseEvent = true;
+    // first call: reading starts after the current entry
+    if (fReadEntry == -2) fReadEntry = fCurrentEntry;
 
-    if (fDoN200Cut) {
-        // dark selection: OD max N200 <= 20 && ID max N200 <= 50
-        auto idHist = Histogram(fIDTQReal->T, 5000, -500e3, 500e3);
-        auto odHist = Histogram(fODTQReal->T, 5000, -500e3, 500e3);
-        for (int iBin=0; iBin<5000; iBin++) {
-            if (odHist[iBin].second > fODMaxN200 | idHist[iBin].second > fIDMaxN200) {
-                fMsg.Print(Form("Rejecting noise event with OD N200 %d and ID N200 %d...",
-                                 odHist[iBin].second, idHist[iBin].second), pWARNING);
-                useThisNoiseEvent = false; break;
-            }
+    if (!fMaxQueueSize) {
+        ReadNoiseEvent(noiseEvent);
+        return;
+    }
+
+    if (!fNoiseReader.joinable()) {
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,0,0)
+        ROOT::EnableThreadSafety();
+#else
+        // ROOT 5 cannot read a TTree on one thread while the main thread does ROOT I/O:
+        // only noise banks, read without ROOT, are prefetched
+        if (!fNoiseBank.IsOpen()) {
+            fMsg.Print("Noise prefetching needs a noise bank with ROOT 5, reading noise trees without prefetching...", pWARNING);
+            fMaxQueueSize = 0;
+            ReadNoiseEvent(noiseEvent);
+            return;
         }
+        TThread::Initialize();
+#endif
+        fNoiseReader = std::thread(&NoiseManager::RunNoiseReader, this);
+    }
+
+    std::unique_lock<std::mutex> lock(fQueueMutex);
+    fQueueCondition.wait(lock, [this]{ return !fNoiseQueue.empty(); });
+    noiseEvent = std::move(fNoiseQueue.front());
+    fNoiseQueue.pop_front();
+    lock.unlock();
+    fQueueCondition.notify_all();
+}
+
+void NoiseManager::RunNoiseReader()
+{
+    bool isValid = true;
+    while (isValid) {
+        NoiseEvent noiseEvent;
+        ReadNoiseEvent(noiseEvent);
+        isValid = noiseEvent.isValid;
+
+        std::unique_lock<std::mutex> lock(fQueueMutex);
+        fQueueCondition.wait(lock, [this]{ return fDoStopReader || fNoiseQueue.size() < fMaxQueueSize; });
+        if (fDoStopReader) return;
+        fNoiseQueue.push_back(std::move(noiseEvent));
+        lock.unlock();
+        fQueueCondition.notify_all();
     }
+}
+
+void NoiseManager::StopNoiseReader()
+{
+    if (!fNoiseReader.joinable()) return;
 
-    // make sure noise event is not empty
-    if (!fIDTQReal->nhits || !fODTQReal->nhits) {
-        fMsg.Print(Form("Skipping an empty noise event..."), pWARNING);
-        useThisNoiseEvent = false;
+    {
+        std::lock_guard<std::mutex> lock(fQueueMutex);
+        fDoStopReader = true;
     }
+    fQueueCondition.notify_all();
+    fNoiseReader.join();
+}
 
-    // populate hit clusters
-    if (useThisNoiseEvent) {
-        PopulateHitCluster(&fIDNoiseEventHits);
-        PopulateHitCluster(&fODNoiseEventHits, true);
+void NoiseManager::ReadNoiseEvent(NoiseEvent& noiseEvent)
+{
+    // runs on the noise reader thread if prefetching: no printing, no ranGen
+    int nTrials = 0;
+    noiseEvent.isValid = false;
 
-        int nHits = fIDNoiseEventHits.GetSize();
-        float idMinT = fIDNoiseEventHits.First().t(); float idMaxT = fIDNoiseEventHits.Last().t();
-        float odMinT = fODNoiseEventHits.First().t(); float odMaxT = fODNoiseEventHits.Last().t();
-        float minT = idMinT>odMinT ? idMinT : odMinT;
-        float maxT = idMaxT<odMaxT ? idMaxT : odMaxT;
-        fNoiseEventMinT = minT; fNoiseEventMaxT = maxT;
-
-        fNoiseEventLength = maxT - minT;
-        fNParts = (int)(fNoiseEventLength / fNoiseWindowWidth);
-        auto random = ranGen.Uniform();
-        fNoiseT0 = minT + (fNoiseEventLength - fNParts*fNoiseWindowWidth)*random;
-
-        if (fNoiseEventLength < fNoiseWindowWidth) {
-            fMsg.Print(Form("Noise event length %3.2f us is smaller than required window width %3.2f us, "
-                            "getting next noise event...",
-                            fNoiseEventLength*1e-3, fNoiseWindowWidth*1e-3), pWARNING);
-            GetNextNoiseEvent();
+    while (!noiseEvent.isValid) {
+
+        // give up after a full pass over the noise tree without a usable event
+        if (nTrials++ > fNEntries) {
+            noiseEvent.error = "Could not find any usable noise event in the whole noise tree!";
+            return;
+        }
+
+        fReadEntry++;
+        if (fReadEntry >= fNEntries) {
+            // events picked at random may wrap around without repetition
+            if (fDoSeedPerEvent) { fReadEntry = 0; continue; }
+
+            noiseEvent.warnings.push_back("Noise tree reached its end!");
+            if (!fDoRepeat) {
+                noiseEvent.error = "Repetition disallowed. To allow, use NoiseManager::SetRepeat(true).";
+                return;
+            }
+            // start from beginning
+            noiseEvent.warnings.push_back("Repetition allowed: going back to the first entry in noise tree...");
+            fReadEntry = 0;
+        }
+
+        // noise bank entries are selected by trigger type at conversion
+        const NoiseBankEntry* bankEntry = fNoiseBank.IsOpen() ? &fNoiseBank.GetEntry(fReadEntry) : nullptr;
+        if (!bankEntry) {
+            fNoiseTree->GetEntry(GetTreeEntry(fReadEntry));
+            if (!IsNoiseTrigger(fHeader->idtgsk)) continue;
+        }
+
+        if (fDoN200Cut) {
+            // dark selection: OD max N200 <= 20 && ID max N200 <= 50
+            int idMaxN200 = bankEntry ? bankEntry->idMaxN200 : GetMaxN200(fIDTQReal->T);
+            int odMaxN200 = bankEntry ? bankEntry->odMaxN200 : GetMaxN200(fODTQReal->T);
+            if (odMaxN200 > fODMaxN200 || idMaxN200 > fIDMaxN200) {
+                noiseEvent.warnings.push_back("Rejecting noise event with OD N200 " + std::to_string(odMaxN200)
+                                              + " and ID N200 " + std::to_string(idMaxN200) + "...");
+                continue;
+            }
+        }
+
+        // make sure noise event is not empty
+        if (bankEntry ? (!bankEntry->nIDHits || !bankEntry->nODHits) : (!fIDTQReal->nhits || !fODTQReal->nhits)) {
+            noiseEvent.warnings.push_back("Skipping an empty noise event...");
+            continue;
+        }
+
+        // populate hit clusters
+        noiseEvent.idHits.Clear(); noiseEvent.odHits.Clear();
+        PopulateHitCluster(&noiseEvent.idHits);
+        PopulateHitCluster(&noiseEvent.odHits, true);
+        if (noiseEvent.idHits.IsEmpty() || noiseEvent.odHits.IsEmpty()) {
+            noiseEvent.warnings.push_back("Skipping an empty noise event...");
+            continue;
+        }
+
+        float idMinT = noiseEvent.idHits.First().t(); float idMaxT = noiseEvent.idHits.Last().t();
+        float odMinT = noiseEvent.odHits.First().t(); float odMaxT = noiseEvent.odHits.Last().t();
+        noiseEvent.minT = idMinT>odMinT ? idMinT : odMinT;
+        noiseEvent.maxT = idMaxT<odMaxT ? idMaxT : odMaxT;
+
+        float noiseEventLength = noiseEvent.maxT - noiseEvent.minT;
+        if (noiseEventLength < fNoiseWindowWidth) {
+            // Form is not thread-safe
+            char warning[128];
+            snprintf(warning, sizeof(warning), "Noise event length %3.2f us is smaller than required window width %3.2f us, "
+                                               "getting next noise event...",
+                     noiseEventLength*1e-3, fNoiseWindowWidth*1e-3);
+            noiseEvent.warnings.push_back(warning);
+            continue;
         }
-    }
 
-    else GetNextNoiseEvent();
+        noiseEvent.entry = fReadEntry;
+        if (bankEntry) {
+            noiseEvent.run = bankEntry->run; noiseEvent.subrun = bankEntry->subrun; noiseEvent.event = bankEntry->event;
+        }
+        else {
+            noiseEvent.run = fHeader->nrunsk; noiseEvent.subrun = fHeader->nsubsk; noiseEvent.event = fHeader->nevsk;
+        }
+        noiseEvent.isValid = true;
+    }
 }
 
 void NoiseManager::AddNoise(PMTHitCluster* signalHits, PMTHitCluster* noiseHits, int& currentHitIndex, float darkRate, bool OD)
 {
+    // reused between calls to keep its capacity
+    fNoiseBuffer.Clear();
+
     // noise from noise files
-    if (fNoiseTree) {
-        if (fCurrentEntry == -1 || fPartID == fNParts) {
+    if (fNoiseTree || fNoiseBank.IsOpen()) {
+        if (fDoSeedPerEvent) {
+            if (fPickedEventIndex != fEventIndex) PickNoiseEvent();
+        }
+        else if (fCurrentEntry == -1 || fPartID == fNParts) {
 			if (fDoRandomizeFirstEntry && fCurrentEntry == -1 && fRandomizedFirstEntry != -1) {
 				fCurrentEntry = fRandomizedFirstEntry - 1;
 				fRandomizedFirstEntry = -1; // Change the fCurrentEntry, only for the first time.
@@ -431,54 +951,162 @@ void NoiseManager::AddNoise(PMTHitCluster* signalHits, PMTHitCluster* noiseHits,
             currentHitIndex++;
         }
 
+        // rate scaling: thin this part if scale < 1, or superpose more parts if scale > 1
+        float scale = GetNoiseRateScale(OD);
+        TRandom3& rng = fDoSeedPerEvent ? fEventRanGen : ranGen;
+
         while (noiseHits->At(currentHitIndex).t() < partEndTime) {
-            PMTHit hit = noiseHits->At(currentHitIndex);
-            hit += (fNoiseStartTime - partStartTime);
-            signalHits->Append(hit);
+            if (scale >= 1 || rng.Uniform() < scale) {
+                PMTHit hit = noiseHits->At(currentHitIndex);
+                hit += (fNoiseStartTime - partStartTime);
+                fNoiseBuffer.Append(hit);
+            }
             currentHitIndex++;
         }
-    }
 
-    // in case fNoiseTree is empty, simulate noise
-    else {
-        int nSegments = int(fNoiseWindowWidth / fPMTDeadtime);
-        float expected = darkRate * 1e3 * fPMTDeadtime * 1e-9;
-
-        unsigned int iMinPMT = !OD? 1 : 20001;
-        unsigned int iMaxPMT = !OD? MAXPM : 20000+MAXPMA;
-
-        for (unsigned int iPMT=iMinPMT; iPMT<=iMaxPMT; iPMT++) {
-            for (unsigned int iSeg=0; iSeg<=nSegments; iSeg++) {
-                int sampled = ranGen.Poisson(expected);
-                if (sampled) {
-                    float hitT = fNoiseStartTime + (iSeg + ranGen.Uniform()) * fPMTDeadtime;
-                    if (hitT < fNoiseEndTime) {
-                        float hitQ = abs(ranGen.Gaus(1, 0.7));
-                        PMTHit hit(hitT, hitQ, iPMT, 2/* in-gate */);
-                        signalHits->Append(hit);
-                    }
+        if (!fExtraNoiseEvents.empty()) {
+            // windows of the superposed events start at random times, shared by ID and OD
+            if (fExtraPartID != fPartID) {
+                fExtraStartTimes.resize(fExtraNoiseEvents.size());
+                for (unsigned int iExtra=0; iExtra<fExtraNoiseEvents.size(); iExtra++) {
+                    auto const& extraEvent = fExtraNoiseEvents[iExtra];
+                    fExtraStartTimes[iExtra] = extraEvent.minT + rng.Uniform() * (extraEvent.maxT - extraEvent.minT);
                 }
+                fExtraPartID = fPartID;
             }
+            for (unsigned int iExtra=0; iExtra<fExtraNoiseEvents.size(); iExtra++)
+                AppendShiftedPart(fExtraNoiseEvents[iExtra], fExtraStartTimes[iExtra],
+                                  !OD ? fExtraKeepProbs[iExtra] : fExtraODKeepProbs[iExtra], rng, OD);
+            fNoiseBuffer.Sort();
         }
     }
-    //fMsg.Print("ApplyDeadtime: ", pDEFAULT, false);
-    auto res = signalHits->ApplyDeadtime(fPMTDeadtime, true);
-    signalHits->Sort();
 
-    if (res.nRemoved) {
-        std::cout << "[NoiseManager] Removed " << res.nRemoved << Form(" ( %d due to signal ) ", res.nRemovedBySignal)
-                  << "hits for PMT deadtime " << fPMTDeadtime << " ns\n";
+    // in case fNoiseTree is empty, simulate noise
+    else {
+        SimulateNoise(&fNoiseBuffer, darkRate, OD);
+        fNoiseBuffer.Sort();
     }
 
+    // signal and noise hits are both time-sorted: merge them while applying PMT deadtime
+    auto res = signalHits->MergeWithDeadtime(fNoiseBuffer, fPMTDeadtime);
+
+    if (res.nRemoved && fMsg.IsEnabled(pDEBUG))
+        fMsg.Print(Form("Removed %u ( %u due to signal ) hits for PMT deadtime %3.2f ns",
+                        res.nRemoved, res.nRemovedBySignal, fPMTDeadtime), pDEBUG);
+
     //signalHits->CheckNaN();
-    if (!OD) fPartID++;
+    if (!OD && !fDoSeedPerEvent) fPartID++;
+}
+
+float NoiseManager::GetNoiseRateScale(bool OD)
+{
+    // the target rate is an ID dark rate: OD noise is scaled by fRateScale only
+    if (!OD && fTargetIDDarkRatekHz > 0 && fNoiseEventIDDarkRatekHz > 0)
+        return fTargetIDDarkRatekHz / fNoiseEventIDDarkRatekHz;
+    else
+        return fRateScale;
+}
+
+void NoiseManager::AppendShiftedPart(NoiseEvent& noiseEvent, float startTime, float keepProb, TRandom3& rng, bool OD)
+{
+    if (keepProb <= 0) return;
+
+    // a window of the noise event from startTime, wrapped around the event range
+    PMTHitCluster& noiseHits = !OD? noiseEvent.idHits : noiseEvent.odHits;
+    float minT = noiseEvent.minT, maxT = noiseEvent.maxT;
+    float endTime = startTime + fNoiseWindowWidth;
+    float wrappedEndTime = minT + (endTime - maxT);
+
+    auto appendRange = [&](float tMin, float tMax, float tOffset) {
+        for (unsigned int iHit=noiseHits.GetLowerBoundIndex(tMin); iHit<noiseHits.GetSize(); iHit++) {
+            if (noiseHits.At(iHit).t() >= tMax) break;
+            if (keepProb < 1 && rng.Uniform() >= keepProb) continue;
+            PMTHit hit = noiseHits.At(iHit);
+            hit += tOffset;
+            fNoiseBuffer.Append(hit);
+        }
+    };
+
+    appendRange(startTime, std::min(endTime, maxT), fNoiseStartTime - startTime);
+    if (endTime > maxT)
+        appendRange(minT, wrappedEndTime, fNoiseStartTime + (maxT - startTime) - minT);
+}
+
+void NoiseManager::SimulateNoise(PMTHitCluster* signalHits, float darkRate, bool OD)
+{
+    // per-event seed from (seed, event index, ID/OD), so that any event can be reproduced alone
+    TRandom3& rng = fDoSeedPerEvent ? fEventRanGen : ranGen;
+    if (fDoSeedPerEvent)
+        rng.SetSeed(MixSeed(fEventSeed, fEventIndex, OD));
+
+    unsigned int iMinPMT = !OD? 1 : 20001;
+    unsigned int iMaxPMT = !OD? MAXPM : 20000+MAXPMA;
+    bool usePMTRates = !OD && !fIDPMTDarkRatekHz.empty();
+
+    float expected = darkRate * 1e-6 * fNoiseWindowWidth * (iMaxPMT - iMinPMT + 1);
+    signalHits->Reserve(signalHits->GetSize() + (unsigned int)(expected + 5*sqrt(expected) + 10));
+
+    // renewal process per PMT: exponential waiting time after each PMT deadtime
+    for (unsigned int iPMT=iMinPMT; iPMT<=iMaxPMT; iPMT++) {
+        float rate = 1e-6 * (usePMTRates ? fIDPMTDarkRatekHz[iPMT-1] : darkRate); // hits per ns
+        if (rate <= 0) continue;
+        float meanWait = 1. / rate;
+
+        float hitT = fNoiseStartTime + rng.Exp(meanWait);
+        while (hitT < fNoiseEndTime) {
+            signalHits->Append(PMTHit(hitT, SampleCharge(rng), iPMT, 2/* in-gate */));
+            hitT += fPMTDeadtime + rng.Exp(meanWait);
+        }
+    }
+}
+
+float NoiseManager::SampleCharge(TRandom3& rng)
+{
+    switch (fChargeModel) {
+        case mExpCharge:  return rng.Exp(fChargeMean);
+        case mUnitCharge: return fChargeMean;
+        default:          return fabs(rng.Gaus(fChargeMean, fChargeSigma));
+    }
+}
+
+void NoiseManager::LoadPMTDarkRates(int runNo)
+{
+    // the search and the read below replace the global bad channel tables
+    int prevRunNo = SKIO::GetBadChRunNo();
+    int prevSubrunNo = SKIO::GetBadChSubrunNo();
+
+    int nearestRunNo = SKIO::FindNearestBadChannelRun(runNo);
+    if (!nearestRunNo)
+        fMsg.Print(Form("Could not find dark rates near run %d for noise simulation!", runNo), pERROR);
+    SKIO::SetBadChannels(nearestRunNo, 0);
+
+    const int nPMTs = sizeof(comdark_.dark_rate) / sizeof(comdark_.dark_rate[0]);
+    fIDPMTDarkRatekHz.assign(comdark_.dark_rate, comdark_.dark_rate + nPMTs);
+    fMsg.Print(Form("Using per-PMT dark rates of run %d (average %3.2f kHz) for noise simulation",
+                    nearestRunNo, comdark_.dark_ave));
+
+    // restore the tables in use before (from the SKIO cache)
+    if (prevRunNo) SKIO::SetBadChannels(prevRunNo, prevSubrunNo);
+    else           SKIO::ResetBadChannels();
 }
 
 void NoiseManager::PopulateHitCluster(PMTHitCluster* hitCluster, bool OD)
 {
-    std::vector<float> t = !OD? fIDTQReal->T      : fODTQReal->T;
-    std::vector<float> q = !OD? fIDTQReal->Q      : fODTQReal->Q;
-    std::vector<int>   i = !OD? fIDTQReal->cables : fODTQReal->cables;
+    // noise bank hits are already range-selected and time-sorted
+    if (fNoiseBank.IsOpen()) {
+        const NoiseBankEntry& entry = fNoiseBank.GetEntry(fReadEntry);
+        const NoiseBankHit* hits = !OD? fNoiseBank.GetIDHits(entry) : fNoiseBank.GetODHits(entry);
+        unsigned int nHits = !OD? entry.nIDHits : entry.nODHits;
+
+        hitCluster->Reserve(nHits);
+        for (unsigned int j=0; j<nHits; j++)
+            hitCluster->Append(PMTHit(hits[j].t, hits[j].q, hits[j].i, 2/*in-gate flag*/));
+        return;
+    }
+
+    const std::vector<float>& t = !OD? fIDTQReal->T      : fODTQReal->T;
+    const std::vector<float>& q = !OD? fIDTQReal->Q      : fODTQReal->Q;
+    const std::vector<int>&   i = !OD? fIDTQReal->cables : fODTQReal->cables;
 
     unsigned int nRawHits = t.size();
 
@@ -488,8 +1116,12 @@ void NoiseManager::PopulateHitCluster(PMTHitCluster* hitCluster, bool OD)
         if (-1000e3 < t[j] && t[j] < 1000e3) {
             hitCluster->Append({t[j], q[j], i[j]&0x0000FFFF, 2/*in-gate flag*/});
         }
-        else
-            fMsg.Print(Form("Skipping hit with time T=%3.2f msec which is outside of range [-1, 1] msec...", t[j]*1e-6), pDEBUG);
+        else if (fMsg.IsEnabled(pDEBUG)) {
+            // Form is not thread-safe, and this runs on the noise reader thread when prefetching
+            char message[128];
+            snprintf(message, sizeof(message), "Skipping hit with time T=%3.2f msec which is outside of range [-1, 1] msec...", t[j]*1e-6);
+            fMsg.Print(message, pDEBUG);
+        }
     }
 
     hitCluster->Sort();
@@ -509,4 +1141,5 @@ void NoiseManager::AddIDODNoise(PMTHitCluster* idSignalHits, PMTHitCluster* odSi
 {
     AddODNoise(odSignalHits);
     AddIDNoise(idSignalHits);
+    fEventIndex++;
 }
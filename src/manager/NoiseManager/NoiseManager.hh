@@ -2,10 +2,19 @@
 #define NOISEMANAGER_HH
 
 #include <vector>
+#include <deque>
+#include <map>
+#include <string>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include <TRandom3.h>
 
 #include "Store.hh"
 #include "Printer.hh"
 #include "PMTHitCluster.hh"
+#include "NoiseBank.hh"
 
 class TChain;
 class TQReal;
@@ -18,6 +27,28 @@ enum NoiseTriggerType
     mNickel = (1<<14)
 };
 
+enum NoiseChargeModel
+{
+    mGausCharge, ///< |Gaus(mean, sigma)|
+    mExpCharge,  ///< Exponential with the given mean
+    mUnitCharge  ///< Fixed charge equal to the given mean
+};
+
+/******************************************
+* @brief A dummy trigger event ready for
+* noise addition.
+*******************************************/
+struct NoiseEvent
+{
+    int entry;
+    int run, subrun, event;
+    PMTHitCluster idHits, odHits; ///< Time-sorted hits
+    float minT, maxT;             ///< Time range covered by both ID and OD hits
+    bool isValid;                 ///< \c false if noise supply ran out (see #error)
+    std::string error;
+    std::vector<std::string> warnings; ///< Warnings to print when the event is used
+};
+
 class NoiseManager
 {
     public:
@@ -36,24 +67,37 @@ class NoiseManager
         void SetSeed(int seed) { fNoiseSeed = seed; ranGen.SetSeed(seed); }
         void SetSKGeneration(int gen) { fSKGen = gen; }
         void SetRandomizeFirstEntry(bool b) { fDoRandomizeFirstEntry = b; }
+        // scale < 1: random thinning, scale > 1: superposition of random windows of other noise events
+        // targetIDRatekHz > 0: scale each noise event to this mean ID dark rate
+        void SetRateScale(float scale, float targetIDRatekHz=0) { fRateScale = scale; fTargetIDDarkRatekHz = targetIDRatekHz; }
+        void SetPrefetch(int nEvents) { fMaxQueueSize = nEvents > 0 ? nEvents : 0; } // 0: read on the calling thread
+        void SetChargeModel(NoiseChargeModel model, float mean=1, float sigma=0.7)
+        { fChargeModel = model; fChargeMean = mean; fChargeSigma = sigma; }
+        void SetEventSeeding(bool b, unsigned int baseSeed) { fDoSeedPerEvent = b; fEventSeed = baseSeed; }
+        // with event seeding, noise of each event is a function of (seed, event index) only
+        void SetEventIndex(long eventIndex) { fEventIndex = eventIndex; }
+        void LoadPMTDarkRates(int runNo); // per-PMT ID dark rates for simulation
         void DumpSettings();
 
         // noise tree generation
         void AddNoiseFileToChain(TChain* chain, TString noiseFilePath);
         void SetNoiseTree(TChain* tree);
         void DumpNoiseFileList(TString pathToFileList);
+        void DumpNoiseBank(TString pathToBank); // converts noise tree to a noise bank
+        void DumpNoiseCatalog(TString noiseType, TString pathToCatalog, bool doSaveEntryList=false);
+        void SetNoiseBank(TString pathToBank);
 
         // full noise tree generation from scratch
         void SetNoiseTreeFromOptions(TString option, int nInputEvents, float tStart, float tEnd, int seed=0);
         void SetNoiseTreeFromList(TString pathToList);
+        void SetNoiseTreeFromCatalog(TString pathToCatalog, TString option, int nInputEvents, float tStart, float tEnd, int seed=0);
         void SetNoiseTreeFromWildcard(TString wildcard, float tStart=0, float tEnd=535);
 
         // initialize from Store
         void ApplySettings(Store& store, int nInputEvents);
 
         // event navigation within tree
-        void GetNextNoiseEvent(); // checks trigger, tree size and current entry
-        void SetNoiseEventHits(); // reads in noise hits from current noise entry
+        void GetNextNoiseEvent(); // takes the next usable noise event
         void SetVerbosity(Verbosity verbose) { fMsg.SetVerbosity(verbose); }
 
         // add noise to input PMTHitCluster
@@ -61,9 +105,9 @@ class NoiseManager
         void AddODNoise(PMTHitCluster* signalHits);
         void AddIDODNoise(PMTHitCluster* idSignalHits, PMTHitCluster* odSignalHits);
 
-        int GetCurrentRun() { return fHeader->nrunsk; }
-        int GetCurrentSubrun() { return fHeader->nsubsk; }
-        int GetCurrentEventID() { return fHeader->nevsk; }
+        int GetCurrentRun() { return fCurrentRun; }
+        int GetCurrentSubrun() { return fCurrentSubrun; }
+        int GetCurrentEventID() { return fCurrentEventID; }
         float GetCurrentHitTime() { return fIDNoiseEventHits[fCurrentIDHitIndex].t(); }
         float GetCurrentPartStartTime() { return fCurrentPartStartTime; }
         float GetCurrentPartEndTime() { return fCurrentPartEndTime; }
@@ -71,11 +115,30 @@ class NoiseManager
 
     protected:
         void PopulateHitCluster(PMTHitCluster* hitCluster, bool OD=false);
+
+        // noise reading, on a separate thread if prefetching
+        void TakeNoiseEvent(NoiseEvent& noiseEvent);
+        void ReadNoiseEvent(NoiseEvent& noiseEvent); // checks trigger, N200, tree size and current entry
+        void RunNoiseReader();
+        void UseNoiseEvent(NoiseEvent& noiseEvent, TRandom3& rng);
+        void PrintNoiseEventMessages(const NoiseEvent& noiseEvent); // aborts if noiseEvent is invalid
+        void PickNoiseEvent(); // random entry and part for the current event index
+        float GetNoiseRateScale(bool OD=false);
+        float GetIDDarkRatekHz(const NoiseEvent& noiseEvent); // per live ID PMT of the noise run
+        int GetNLiveIDPMTs(int runNo, int subrunNo);
+        void PrepareExtraNoiseEvents(TRandom3& rng); // noise events to superpose if scaling up
+        void AppendShiftedPart(NoiseEvent& noiseEvent, float startTime, float keepProb, TRandom3& rng, bool OD=false);
+        void StopNoiseReader();
+        long GetTreeEntry(int iEntry) { return fNoiseEntryList.empty() ? iEntry : fNoiseEntryList[iEntry]; }
         void AddNoise(PMTHitCluster* signalHits, PMTHitCluster* noiseHits, int& currentHitIndex, float darkRate, bool OD=false);
+        void SimulateNoise(PMTHitCluster* signalHits, float darkRate, bool OD=false);
+        float SampleCharge(TRandom3& rng);
 
     private:
         TChain* fNoiseTree;
         TString fNoiseTreeName;
+        NoiseBank fNoiseBank;
+        std::vector<long> fNoiseEntryList; // selected noise tree entries from a noise catalog
 
         TString fNoisePath;
         TString fNoiseType;
@@ -84,6 +147,7 @@ class NoiseManager
         Header* fHeader;
         TQReal* fIDTQReal;
         TQReal* fODTQReal;
+        int fCurrentRun, fCurrentSubrun, fCurrentEventID;
 
         int fSKGen;
         int fNoiseSeed;
@@ -110,11 +174,40 @@ class NoiseManager
 		bool fDoRandomizeFirstEntry;
 		int  fRandomizedFirstEntry;
 
+        // noise simulation
+        NoiseChargeModel fChargeModel;
+        float fChargeMean, fChargeSigma;
+        std::vector<float> fIDPMTDarkRatekHz; // empty: flat fIDDarkRatekHz
+
+        // per-event seeding
+        bool fDoSeedPerEvent;
+        unsigned int fEventSeed;
+        long fEventIndex, fPickedEventIndex;
+        TRandom3 fEventRanGen;
+
+        // noise rate scaling
+        float fRateScale;
+        float fTargetIDDarkRatekHz, fNoiseEventIDDarkRatekHz;
+        std::vector<NoiseEvent> fExtraNoiseEvents; // superposed with the current noise event
+        std::vector<float> fExtraKeepProbs, fExtraODKeepProbs, fExtraStartTimes;
+        std::map<std::pair<int, int>, int> fNLiveIDPMTs; // per noise run and subrun
+        int fExtraPartID; // part for which fExtraStartTimes are drawn
+
         //std::vector<float> fT, fQ;
         //std::vector<int>   fI;
 
         PMTHitCluster fIDNoiseEventHits;
         PMTHitCluster fODNoiseEventHits;
+        PMTHitCluster fNoiseBuffer; // noise hits to merge into signal
+
+        // noise reader
+        int fReadEntry; // last entry read by the noise reader
+        unsigned int fMaxQueueSize;
+        bool fDoStopReader;
+        std::deque<NoiseEvent> fNoiseQueue;
+        std::mutex fQueueMutex;
+        std::condition_variable fQueueCondition;
+        std::thread fNoiseReader;
 
         Printer fMsg;
 };
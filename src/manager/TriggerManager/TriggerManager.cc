@@ -2,6 +2,7 @@
 #include <skparmC.h>
 #include <skruninfC.h>
 #include <stdint.h>
+#include <algorithm>
 #include <skonl/softtrg_tbl.h>
 #undef MAXPM
 #undef MAXPMA
@@ -25,18 +26,15 @@ const int TriggerManager::QBEE_QTC_LARGE  = 2;
 const int TriggerManager::IQ_INGATE_FLAG  = 2048;
 
 const int TriggerManager::SWTRG_SAME_GATE_WIDTH = 768;
+const int TriggerManager::SWTRG_NHIT_WIDTH = 384; // 200 ns
 
 TriggerManager::TriggerManager(int refRunNo=0)
+: fRawGate(0), fRawGateOD(0), fTriggerMask(-1), fIT0SK(0), fIDTGSK(0)
 {
-    int softtrg_detector[32];
-    int softtrg_thr[32];
-    int softtrg_t0_offset[32];
-    int softtrg_pre_t0[32];
-    int softtrg_post_t0[32];
-    softtrg_get_cond_(softtrg_detector, softtrg_thr, softtrg_t0_offset,softtrg_pre_t0, softtrg_post_t0);
+    softtrg_get_cond_(fTrgDetector, fTrgThreshold, fTrgT0Offset, fTrgPreT0, fTrgPostT0);
     if (refRunNo)
-        get_run_softtrg_(&refRunNo, softtrg_detector, softtrg_thr, softtrg_t0_offset, softtrg_pre_t0, softtrg_post_t0);
-    softtrg_set_cond_(softtrg_detector, softtrg_thr, softtrg_t0_offset, softtrg_pre_t0, softtrg_post_t0);
+        get_run_softtrg_(&refRunNo, fTrgDetector, fTrgThreshold, fTrgT0Offset, fTrgPreT0, fTrgPostT0);
+    softtrg_set_cond_(fTrgDetector, fTrgThreshold, fTrgT0Offset, fTrgPreT0, fTrgPostT0);
 }
 
 void TriggerManager::ApplyTrigger(PMTHitCluster& hits)
@@ -46,7 +44,7 @@ void TriggerManager::ApplyTrigger(PMTHitCluster& hits)
     fIDTGSK = skhead_.idtgsk;
 
     // Make tqrawinfo_ struct
-    skruninf_.softtrg_mask = -1;
+    skruninf_.softtrg_mask = fTriggerMask;
     fRawGate = 0;
     fRawGateOD = 0;
     //int currentHitID = 0;
@@ -68,10 +66,74 @@ void TriggerManager::ApplyTrigger(PMTHitCluster& hits)
     // Apply software trigger
     int iCandidates = softtrg_inittrgtbl_(&iRunSK, &iFirstHWCtr, &iInGateOnly, &iMaxQBeeTBL);
     //std::cout <<" N cand: "<<iCandidates<<std::endl;
-    int iPrimaryTrigger = FindMainTrigger(iCandidates, tmpTOffset);
-    fIT0SK  = swtrgtbl_.swtrgt0ctr[iPrimaryTrigger];
-    fIDTGSK = swtrgtbl_.swtrgtype[iPrimaryTrigger];
+    fTriggers.clear();
+    for (int iTrig = 0; iTrig < iCandidates; iTrig++)
+        fTriggers.push_back({swtrgtbl_.swtrgtype[iTrig], swtrgtbl_.swtrgt0ctr[iTrig]});
 
+    FindMainTrigger(tmpTOffset);
+    SetTriggerGate(hits, tmpTOffset);
+}
+
+void TriggerManager::ApplyNativeTrigger(PMTHitCluster& hits)
+{
+    float tmpTOffset = (1024.*32./COUNT_PER_NSEC);
+
+    FindTriggers(hits, tmpTOffset);
+    FindMainTrigger(tmpTOffset);
+    SetTriggerGate(hits, tmpTOffset);
+}
+
+const std::vector<SoftwareTrigger>& TriggerManager::FindTriggers(const PMTHitCluster& hits, float tOffset)
+{
+    float minGate = -5.e3;
+    float maxGate = 35.0e3;
+
+    // digitized hit times, same as MakeTQRAW
+    fIDHitT.clear();
+    fODHitT.clear();
+    for (auto const& hit: hits) {
+        if (minGate < hit.t() && hit.t() < maxGate) {
+            int iT = (int)(uint64_t)((hit.t() + tOffset)*COUNT_PER_NSEC);
+            if (hit.i() <= MAXPM) fIDHitT.push_back(iT);
+            else                  fODHitT.push_back(iT);
+        }
+    }
+    std::sort(fIDHitT.begin(), fIDHitT.end());
+    std::sort(fODHitT.begin(), fODHitT.end());
+
+    fTriggers.clear();
+    for (int type: {TRGID_SW_SLE, TRGID_SW_LE, TRGID_SW_HE, TRGID_SHE})
+        FindNHitTriggers(fIDHitT, type);
+    FindNHitTriggers(fODHitT, TRGID_SW_OD);
+
+    std::stable_sort(fTriggers.begin(), fTriggers.end(),
+                     [](const SoftwareTrigger& a, const SoftwareTrigger& b){ return a.t0 < b.t0; });
+
+    return fTriggers;
+}
+
+void TriggerManager::FindNHitTriggers(const std::vector<int>& hitT, int type)
+{
+    int threshold = fTrgThreshold[type];
+    if (!IsTriggerEnabled(type) || threshold <= 0 || (int)hitT.size() < threshold) return;
+
+    // hits in [iFirst, iLast] are within the N-hit window ending at hit iLast
+    int tNext = hitT.front();
+    int iFirst = 0;
+    for (int iLast = 0; iLast < (int)hitT.size(); iLast++) {
+        if (hitT[iLast] < tNext) continue;
+        while (hitT[iLast] - hitT[iFirst] >= SWTRG_NHIT_WIDTH) iFirst++;
+
+        if (iLast - iFirst + 1 >= threshold) {
+            int t0 = hitT[iLast] + fTrgT0Offset[type];
+            fTriggers.push_back({type, t0});
+            tNext = t0 + fTrgPostT0[type];
+        }
+    }
+}
+
+void TriggerManager::SetTriggerGate(PMTHitCluster& hits, float tOffset)
+{
     int iGateStart = -1000 + fIT0SK;
     int iGateEnd   =  1496 + fIT0SK;
     //std::cout <<"main trigger: "<<"\n"
@@ -80,13 +142,13 @@ void TriggerManager::ApplyTrigger(PMTHitCluster& hits)
     // Turn on the flag for 1.3 us around T0
     for (auto& hit: hits) {
         hit.SetFlag(hit.f() & 0xFFFE);
-        uint64_t iT_64 = (uint64_t)((hit.t() + tmpTOffset)*COUNT_PER_NSEC);
+        uint64_t iT_64 = (uint64_t)((hit.t() + tOffset)*COUNT_PER_NSEC);
         int iT = (int)(iT_64);
         if (iT > iGateStart && iT < iGateEnd) {
             hit.SetFlag(hit.f() | 1);
         }
         int iT_diff = -fIT0SK;
-        hit.SetT(hit.t() + (float)(iT_diff/COUNT_PER_NSEC) + tmpTOffset + 1000.);
+        hit.SetT(hit.t() + (float)(iT_diff/COUNT_PER_NSEC) + tOffset + 1000.);
     }
 }
 
@@ -136,61 +198,62 @@ void TriggerManager::MakeTQRAW(int pmtID, float t, float q, float tOffset)
     rawtqinfo_.nqisk_raw = fRawGate;
 }
 
-int TriggerManager::FindMainTrigger(int numTriggers, float tOffset)
+int TriggerManager::FindMainTrigger(float tOffset)
 {
+    int numTriggers = fTriggers.size();
     bool isT0Found = false;
     int iPrimaryTrigger = -1;
     int it0sk_tmp = 0;
     int idtgsk_tmp = 0;
     for ( int iTrig = 0; iTrig < numTriggers; iTrig++ ) {
-        if ( (swtrgtbl_.swtrgtype[iTrig] == TRGID_SW_LE && skruninf_.softtrg_mask&(1<<TRGID_SW_LE)) ||
-             (swtrgtbl_.swtrgtype[iTrig] == TRGID_SW_HE && skruninf_.softtrg_mask&(1<<TRGID_SW_HE)) ||
-             (swtrgtbl_.swtrgtype[iTrig] == TRGID_SHE   && skruninf_.softtrg_mask&(1<<TRGID_SHE))   ||
-             (swtrgtbl_.swtrgtype[iTrig] == TRGID_SW_OD && skruninf_.softtrg_mask&(1<<TRGID_SW_OD)) ) {
+        if ( (fTriggers[iTrig].type == TRGID_SW_LE && IsTriggerEnabled(TRGID_SW_LE)) ||
+             (fTriggers[iTrig].type == TRGID_SW_HE && IsTriggerEnabled(TRGID_SW_HE)) ||
+             (fTriggers[iTrig].type == TRGID_SHE   && IsTriggerEnabled(TRGID_SHE))   ||
+             (fTriggers[iTrig].type == TRGID_SW_OD && IsTriggerEnabled(TRGID_SW_OD)) ) {
 
             if ( isT0Found == false ) {
                 // if this is the first trigger, then store and set flag
                 isT0Found       = true;
                 iPrimaryTrigger = iTrig;
 
-                it0sk_tmp  = swtrgtbl_.swtrgt0ctr[iTrig];
-                idtgsk_tmp = (1 << swtrgtbl_.swtrgtype[iTrig]);
+                it0sk_tmp  = fTriggers[iTrig].t0;
+                idtgsk_tmp = (1 << fTriggers[iTrig].type);
             }
-            else if ( swtrgtbl_.swtrgt0ctr[iTrig] <= it0sk_tmp ) {
+            else if ( fTriggers[iTrig].t0 <= it0sk_tmp ) {
                 // trigger time is earlier, change primary trigger
                 iPrimaryTrigger = iTrig;
 
-                it0sk_tmp  = swtrgtbl_.swtrgt0ctr[iTrig];
-                idtgsk_tmp = (1 << swtrgtbl_.swtrgtype[iTrig]);
+                it0sk_tmp  = fTriggers[iTrig].t0;
+                idtgsk_tmp = (1 << fTriggers[iTrig].type);
             }
         }
     }
 
     for ( int iTrig = 0; iTrig < numTriggers; iTrig++ ) {
-        if ( (swtrgtbl_.swtrgtype[iTrig] == TRGID_SW_LE  && skruninf_.softtrg_mask&(1<< TRGID_SW_LE))  ||
-             (swtrgtbl_.swtrgtype[iTrig] == TRGID_SW_HE  && skruninf_.softtrg_mask&(1<< TRGID_SW_HE))  ||
-             (swtrgtbl_.swtrgtype[iTrig] == TRGID_SW_SLE && skruninf_.softtrg_mask&(1<< TRGID_SW_SLE)) ||
-             (swtrgtbl_.swtrgtype[iTrig] == TRGID_SHE    && skruninf_.softtrg_mask&(1<< TRGID_SHE))    ||
-             (swtrgtbl_.swtrgtype[iTrig] == TRGID_SW_OD  && skruninf_.softtrg_mask&(1<< TRGID_SW_OD)) ) {
+        if ( (fTriggers[iTrig].type == TRGID_SW_LE  && IsTriggerEnabled(TRGID_SW_LE))  ||
+             (fTriggers[iTrig].type == TRGID_SW_HE  && IsTriggerEnabled(TRGID_SW_HE))  ||
+             (fTriggers[iTrig].type == TRGID_SW_SLE && IsTriggerEnabled(TRGID_SW_SLE)) ||
+             (fTriggers[iTrig].type == TRGID_SHE    && IsTriggerEnabled(TRGID_SHE))    ||
+             (fTriggers[iTrig].type == TRGID_SW_OD  && IsTriggerEnabled(TRGID_SW_OD))  ) {
             if ( isT0Found == false ) {
                 // if this is the first trigger, then store and set flag
                 isT0Found       = true;
                 iPrimaryTrigger = iTrig;
 
-                it0sk_tmp  = swtrgtbl_.swtrgt0ctr[iTrig];
-                idtgsk_tmp = (1 << swtrgtbl_.swtrgtype[iTrig]);
+                it0sk_tmp  = fTriggers[iTrig].t0;
+                idtgsk_tmp = (1 << fTriggers[iTrig].type);
             }
 
             // 1.92 count/ns -> 200ns = 384 count
-            if ( abs( swtrgtbl_.swtrgt0ctr[iTrig] - it0sk_tmp ) < 384 ) {
-                idtgsk_tmp |= (1 << swtrgtbl_.swtrgtype[iTrig]);
+            if ( abs( fTriggers[iTrig].t0 - it0sk_tmp ) < 384 ) {
+                idtgsk_tmp |= (1 << fTriggers[iTrig].type);
             }
         }
     }
 
     // if no trigger, t0 is set to GEANT t0 (in units of hardware clock position)
     if ( isT0Found == 0 ) {
-        it0sk_tmp   &= 0x00000000L;
+        it0sk_tmp   = (int)(tOffset*COUNT_PER_NSEC);
         idtgsk_tmp  = 0;
     }
 
@@ -203,7 +266,7 @@ int TriggerManager::FindMainTrigger(int numTriggers, float tOffset)
     // Primary trigger
     int iTriggerBit = 0;
     if (iPrimaryTrigger != -1) {
-        iTriggerBit = (1 << swtrgtbl_.swtrgtype[iPrimaryTrigger]);
+        iTriggerBit = (1 << fTriggers[iPrimaryTrigger].type);
         fSubTrigger_Type.push_back(iTriggerBit);
     }
     else {
@@ -219,9 +282,9 @@ int TriggerManager::FindMainTrigger(int numTriggers, float tOffset)
         // loop over triggers again to get overlap triggers
 
             if (  iTrig != iPrimaryTrigger
-                && abs( it0sk_tmp - swtrgtbl_.swtrgt0ctr[iTrig] ) < SWTRG_SAME_GATE_WIDTH ) {
+                && abs( it0sk_tmp - fTriggers[iTrig].t0 ) < SWTRG_SAME_GATE_WIDTH ) {
 
-                iTriggerBit = (1 << swtrgtbl_.swtrgtype[iTrig]); // Trigger bit
+                iTriggerBit = (1 << fTriggers[iTrig].type); // Trigger bit
                 idtgsk_tmp |= iTriggerBit; // Add bit if needed
             }
         }
@@ -229,18 +292,19 @@ int TriggerManager::FindMainTrigger(int numTriggers, float tOffset)
 
     // Store each trigger, up to max
     for ( int iTrig = 0; iTrig < numTriggers; iTrig++ ) {
-        iTriggerBit = (1 << swtrgtbl_.swtrgtype[iTrig]);
+        iTriggerBit = (1 << fTriggers[iTrig].type);
 
         fSubTrigger_Type   .push_back(iTriggerBit);
-        fSubTrigger_Time   .push_back(swtrgtbl_.swtrgt0ctr[iTrig]);
-        fSubTrigger_TimeRel.push_back( swtrgtbl_.swtrgt0ctr[iTrig]/COUNT_PER_NSEC - tOffset );
+        fSubTrigger_Time   .push_back(fTriggers[iTrig].t0);
+        fSubTrigger_TimeRel.push_back( fTriggers[iTrig].t0/COUNT_PER_NSEC - tOffset );
         // ns from event trigger to geant t0 (should be negative)
         fSubTrigger_Index  .push_back( iTrig );
     }
 
 
-    // overwrite trigger ID of primary trigger
-    swtrgtbl_.swtrgtype[iPrimaryTrigger] = idtgsk_tmp;
+    // trigger ID of primary trigger
+    fIT0SK  = it0sk_tmp;
+    fIDTGSK = idtgsk_tmp;
     return iPrimaryTrigger;
 }
 
@@ -8,6 +8,15 @@
 #include "Printer.hh"
 #include "PMTHitCluster.hh"
 
+/******************************************
+* @brief A software trigger candidate.
+*******************************************/
+struct SoftwareTrigger
+{
+    int type; ///< Trigger ID, e.g., \c TRGID_SW_LE
+    int t0;   ///< Trigger time (clock counts)
+};
+
 class TriggerManager
 {
     public:
@@ -15,9 +24,36 @@ class TriggerManager
         TriggerManager(int runNo);
         ~TriggerManager() {};
 
+        /**
+         * @brief Applies the SK software trigger with \c softtrg_inittrgtbl_.
+         * @details Hits are digitized into \c rawtqinfo_ and the trigger table
+         * is read back from \c swtrgtbl_.
+         */
         void ApplyTrigger(PMTHitCluster& signalHits);
+
+        /**
+         * @brief Applies the native C++ emulation of the SK software trigger.
+         * @details Same as TriggerManager::ApplyTrigger,
+         * but without the common block round trip.
+         * See TriggerManager::FindTriggers.
+         */
+        void ApplyNativeTrigger(PMTHitCluster& signalHits);
+
+        /**
+         * @brief Finds SLE/LE/HE/SHE/OD trigger candidates from \c hits.
+         * @details For each trigger type, the number of ID (OD for \c TRGID_SW_OD)
+         * hits in a sliding 200 ns window is compared with the threshold of the
+         * trigger condition. The trigger time is the time of the hit that reaches
+         * the threshold plus the trigger t0 offset, and the next trigger of
+         * the same type is searched after the post-t0 window.
+         * @param hits Input hits.
+         * @param tOffset Time offset (ns) added to hit times before digitization.
+         * @return Trigger candidates in time order.
+         */
+        const std::vector<SoftwareTrigger>& FindTriggers(const PMTHitCluster& hits, float tOffset);
+
         void MakeTQRAW(int pmtID, float t, float q, float tOffset);
-        int FindMainTrigger(int numTriggers, float tOffset);
+        int FindMainTrigger(float tOffset);
 
         void FillCommon();
         void FillTrgOffset(MCInfo& inputMCINFO);
@@ -26,8 +62,16 @@ class TriggerManager
         std::vector<int> GetTriggerTime() { return fSubTrigger_Time; };
         std::vector<float> GetTriggerTimeRel() { return fSubTrigger_TimeRel; };
         std::vector<int> GetTriggerIndex() { return fSubTrigger_Index; };
+        // trigger candidates of the last ApplyTrigger or ApplyNativeTrigger
+        const std::vector<SoftwareTrigger>& GetTriggers() const { return fTriggers; }
+        int GetT0() const { return fIT0SK; }
+        int GetTriggerID() const { return fIDTGSK; }
 
    private: 
+      void FindNHitTriggers(const std::vector<int>& hitT, int type);
+      void SetTriggerGate(PMTHitCluster& hits, float tOffset);
+      bool IsTriggerEnabled(int type) const { return fTriggerMask & (1 << type); }
+
       int fRawGate;
       int fRawGateOD;
 
@@ -43,6 +87,18 @@ class TriggerManager
 
       static const int IQ_INGATE_FLAG;
       static const int SWTRG_SAME_GATE_WIDTH;
+      static const int SWTRG_NHIT_WIDTH;
+
+      // Software trigger conditions, indexed by trigger ID
+      int fTrgDetector[32];
+      int fTrgThreshold[32];
+      int fTrgT0Offset[32];
+      int fTrgPreT0[32];
+      int fTrgPostT0[32];
+      int fTriggerMask;
+
+      std::vector<SoftwareTrigger> fTriggers;
+      std::vector<int> fIDHitT, fODHitT;
 
       int fIT0SK;
       int fIDTGSK;
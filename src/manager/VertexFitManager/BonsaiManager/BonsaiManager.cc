@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstdint>
 #include <stdio.h>
 
@@ -17,6 +18,7 @@
 #include "SKIO.hh"
 #include "SKLibs.hh"
 
+#include "FitCache.hh"
 #include "BonsaiManager.hh"
 
 float* GetPMTPositionArray()
@@ -32,10 +34,14 @@ float* GetPMTPositionArray()
 
 bool BonsaiManager::fIsLOWFITInitialized = false;
 
+// width of the peak window for hit selection (ns)
+static const Float PEAKTWIDTH = 200;
+
 BonsaiManager::BonsaiManager(Verbosity verbose):
 VertexFitManager("BonsaiManager", verbose), fPMTGeometry(nullptr), fLikelihood(nullptr),
-fFitEnergy(-1), fFitDirKS(-1), fFitOvaQ(-1),
-fRefRunNo(62428), fUseLOWFIT(false)
+fFitEnergy(-1), fFitDirKS(-1), fFitOvaQ(-1), fIsFitGood(false),
+fRefRunNo(62428), fUseLOWFIT(false),
+fMaxNHits(0), fTRMSNHits(0), fTRMSFitManager(verbose)
 {}
 
 BonsaiManager::~BonsaiManager()
@@ -53,7 +59,9 @@ void BonsaiManager::Initialize()
         geoset_();
     }
 
-    fPMTGeometry = new pmt_geometry(MAXPM, GetPMTPositionArray());
+    float* pmtPosition = GetPMTPositionArray();
+    fPMTPositions.assign(pmtPosition, pmtPosition + 3*MAXPM);
+    fPMTGeometry = new pmt_geometry(MAXPM, fPMTPositions.data());
     fLikelihood = new likelihood(fPMTGeometry->cylinder_radius(), fPMTGeometry->cylinder_height());
     fLikelihood->set_hits(NULL);
     SKIO::EnableConsoleOut();
@@ -101,61 +109,149 @@ void BonsaiManager::UseSKG4Parameter( bool turnOn )
     fUseSKG4Parameter = turnOn;
 }
 
+uint64_t BonsaiManager::GetSettingsHash() const
+{
+    // LOWFIT results also depend on the run-wise constants it reads
+    int settings[] = {fUseLOWFIT, skheadg_.sk_geometry, 0, 0, 0, 0};
+    if (fUseLOWFIT) {
+        settings[2] = fRefRunNo; settings[3] = fUseSKG4Parameter;
+        settings[4] = skhead_.mdrnsk; settings[5] = skhead_.nrunsk;
+    }
+    else {
+        settings[2] = fMaxNHits; settings[3] = fTRMSNHits;
+    }
+    uint64_t hash = FitCache::Hash(settings, sizeof(settings));
+
+    if (!fUseLOWFIT && fTRMSNHits) {
+        uint64_t trmsHash = fTRMSFitManager.GetSettingsHash();
+        hash = FitCache::Hash(&trmsHash, sizeof(trmsHash), hash);
+    }
+    return hash;
+}
+
+void BonsaiManager::SetTRMSParameters(const TRMSFitManager& trmsFitManager)
+{
+    fTRMSFitManager = trmsFitManager;
+    fTRMSFitManager.SetVerbosity(fMsg.GetVerbosity());
+}
+
 void BonsaiManager::Fit(const PMTHitCluster& hitCluster)
 {
     if (fUseLOWFIT) {
         FitLOWFIT(hitCluster);
     }
     else {
-        auto t = hitCluster[HitFunc::T];
-        auto q = hitCluster[HitFunc::Q];
-        //auto i = hitCluster.GetProjection(HitFunc::I);
-
-        std::vector<int> i;
-        for (auto const& hit: hitCluster)
-            i.push_back(hit.i());
-
-        goodness hits(fLikelihood->sets(), fLikelihood->chargebins(),
-                      fPMTGeometry, hitCluster.GetSize(),
-                      i.data(), t.data(), q.data());
-
-        if (hits.nselected() >= 4) {
-            fourhitgrid grid(fPMTGeometry->cylinder_radius(), fPMTGeometry->cylinder_height(), &hits);
-            bonsaifit fitter(fLikelihood);
-            fLikelihood->set_hits(&hits);
-            fLikelihood->maximize(&fitter, &grid);
-
-            // successful fit
-            if (fLikelihood->nfit()) {
-                float vertex[3] = {fitter.xfit(), fitter.yfit(), fitter.zfit()};
-                float likelihood0, likelihood1, likelihood2, goodness[1], result[6];
-                fFitVertex = TVector3(vertex);
-                likelihood2 = fLikelihood->goodness(likelihood0, vertex, goodness);
-
-                fLikelihood->tgood(vertex, 0, likelihood1);
-                likelihood0 = fitter.maxq();
-
-                fitter.fitresult();
-                fFitTime = fLikelihood->get_zero();
-                fLikelihood->get_dir(result);
-                result[5] = fLikelihood->get_ll0();
-
-                fFitGoodness = likelihood1;
-
-                // direction
-                // dirks
-                // energy
-                fFitEnergy = 0;
-                fFitDirKS = 0;
-                fFitOvaQ = 0;
-            }
+        // a failed fit should not return the result of the previous fit
+        fFitVertex = TVector3(); fFitTime = 0;
+        fFitEnergy = -1; fFitDirKS = -1; fFitOvaQ = -1;
+        fIsFitGood = false;
+
+        // large windows are dominated by dark hits:
+        // fit with TRMS-fit, or with a bounded number of hits around the peak
+        unsigned int nHits = hitCluster.GetSize();
+        unsigned int low = 0, up = nHits;
+        if (fTRMSNHits && nHits > fTRMSNHits) {
+            FindPeakHits(hitCluster, 0, low, up);
+            fPeakHits.Clear();
+            for (unsigned int iHit=low; iHit<up; iHit++)
+                fPeakHits.Append(hitCluster[iHit]);
+            fTRMSFitManager.Fit(fPeakHits);
+            fFitVertex = fTRMSFitManager.GetFitVertex();
+            fFitTime = fTRMSFitManager.GetFitTime();
+            fIsFitGood = true;
+        }
+        else {
+            if (fMaxNHits && nHits > fMaxNHits)
+                FindPeakHits(hitCluster, fMaxNHits, low, up);
+            FitBONSAI(hitCluster, low, up);
         }
 
-        fLikelihood->set_hits(NULL);
         fFitGoodness = GetGoodness(hitCluster, fFitVertex, fFitTime);
     }
 }
 
+void BonsaiManager::FitBONSAI(const PMTHitCluster& hitCluster, unsigned int low, unsigned int up)
+{
+    // buffers keep their capacity, so no allocation once they are large enough
+    fHitT.clear(); fHitQ.clear(); fHitCable.clear();
+    for (unsigned int iHit=low; iHit<up; iHit++) {
+        auto const& hit = hitCluster[iHit];
+        fHitT.push_back(hit.t());
+        fHitQ.push_back(hit.q());
+        fHitCable.push_back(hit.i());
+    }
+
+    // goodness and fourhitgrid are made from the hits, so they are made for each fit
+    goodness hits(fLikelihood->sets(), fLikelihood->chargebins(),
+                  fPMTGeometry, fHitT.size(),
+                  fHitCable.data(), fHitT.data(), fHitQ.data());
+
+    if (hits.nselected() >= 4) {
+        fourhitgrid grid(fPMTGeometry->cylinder_radius(), fPMTGeometry->cylinder_height(), &hits);
+        bonsaifit fitter(fLikelihood);
+        fLikelihood->set_hits(&hits);
+        fLikelihood->maximize(&fitter, &grid);
+
+        // successful fit
+        if (fLikelihood->nfit()) {
+            float vertex[3] = {fitter.xfit(), fitter.yfit(), fitter.zfit()};
+            float likelihood0, likelihood1, likelihood2, goodness[1], result[6];
+            fFitVertex = TVector3(vertex);
+            likelihood2 = fLikelihood->goodness(likelihood0, vertex, goodness);
+
+            fLikelihood->tgood(vertex, 0, likelihood1);
+            likelihood0 = fitter.maxq();
+
+            fitter.fitresult();
+            fFitTime = fLikelihood->get_zero();
+            fLikelihood->get_dir(result);
+            result[5] = fLikelihood->get_ll0();
+
+            fFitGoodness = likelihood1;
+
+            // direction
+            // dirks
+            // energy
+            fFitEnergy = 0;
+            fFitDirKS = 0;
+            fFitOvaQ = 0;
+            fIsFitGood = true;
+        }
+    }
+
+    fLikelihood->set_hits(NULL);
+}
+
+void BonsaiManager::FindPeakHits(const PMTHitCluster& hitCluster, unsigned int nSelected, unsigned int& low, unsigned int& up) const
+{
+    unsigned int nHits = hitCluster.GetSize();
+    low = 0; up = nHits;
+    if (!nHits) return;
+
+    // peak: window with the most hits
+    unsigned int peakLow = 0, peakUp = 0;
+    for (unsigned int iLow=0, iUp=0; iLow<nHits; iLow++) {
+        while (iUp < nHits && hitCluster[iUp].t() - hitCluster[iLow].t() < PEAKTWIDTH) iUp++;
+        if (iUp - iLow > peakUp - peakLow) { peakLow = iLow; peakUp = iUp; }
+    }
+
+    // nearest hits in time from the peak center form a contiguous range of the time-sorted hits
+    low = peakLow; up = peakUp;
+    if (nSelected) {
+        Float peakT = hitCluster[peakLow].t() + PEAKTWIDTH/2.;
+        nSelected = std::min(nSelected, nHits);
+        up = peakLow;
+        while (up < nHits && hitCluster[up].t() < peakT) up++;
+        low = up;
+        while (up - low < nSelected) {
+            if (low > 0 && (up == nHits || peakT - hitCluster[low-1].t() < hitCluster[up].t() - peakT))
+                low--;
+            else
+                up++;
+        }
+    }
+}
+
 void BonsaiManager::FitLOWFIT(const PMTHitCluster& hitCluster)
 {
     // clear sktq
@@ -231,6 +327,7 @@ void BonsaiManager::FitLOWFIT(const PMTHitCluster& hitCluster)
     fFitTime = skroot_lowe_.bsvertex[3];
 
     fFitGoodness = skroot_lowe_.bsgood[1];
+    fIsFitGood = true;
 
     // bsenergy not ok
     if (skroot_lowe_.bsenergy>9998 || std::isinf( skroot_lowe_.bsenergy ) || std::isnan( skroot_lowe_.bsenergy )) {
@@ -2,6 +2,7 @@
 #define BONSAIMANAGER_HH
 
 #include "VertexFitManager.hh"
+#include "TRMSFitManager.hh"
 
 class pmt_geometry;
 class likelihood;
@@ -19,32 +20,77 @@ class BonsaiManager : public VertexFitManager
 
         void UseLOWFIT(bool turnOn=true, int refRunNo=62428);
         void UseSKG4Parameter(bool turnOn=true);
+
+        /**
+         * @brief Sets the hit selection for fits to large fit windows (not for LOWFIT).
+         * @param maxNHits Windows with more hits are fitted with the \c maxNHits hits nearest to the peak. 0: no limit.
+         * @param trmsNHits Windows with more hits are fitted with TRMS-fit on the hits in the 200 ns peak window. 0: never.
+         */
+        void SetHitSelection(unsigned int maxNHits, unsigned int trmsNHits) { fMaxNHits = maxNHits; fTRMSNHits = trmsNHits; }
+        /**
+         * @brief Sets the TRMS-fit of windows with more than \c trmsNHits hits (see BonsaiManager::SetHitSelection).
+         * @details Grid, minimizer, start, and prompt vertex are copied from \c trmsFitManager.
+         */
+        void SetTRMSParameters(const TRMSFitManager& trmsFitManager);
         void Fit(const PMTHitCluster& hitCluster);
         void FitLOWFIT(const PMTHitCluster& hitCluster);
 
+        // LOWFIT reads and writes common blocks
+        bool IsThreadSafe() const { return !fUseLOWFIT; }
+
+        uint64_t GetSettingsHash() const;
+
         inline unsigned int GetRefRunNo() { return fRefRunNo; }
         inline void SetRefRunNo(unsigned int no) { fRefRunNo = no; }
 
         inline float GetFitEnergy() { return fFitEnergy; }
         inline float GetFitDirKS() { return fFitDirKS; }
         inline float GetFitOvaQ() { return fFitOvaQ; }
+        /** \c false if the last fit found no vertex, e.g., with fewer than 4 selected hits. */
+        inline bool IsFitGood() const { return fIsFitGood; }
 
         void DumpFitResult();
         static bool IsLOWFITInitialized() { return fIsLOWFITInitialized; }
 
     private:
+        /**
+         * @brief BONSAI fit to the hits in [\c low, \c up) of \c hitCluster.
+         */
+        void FitBONSAI(const PMTHitCluster& hitCluster, unsigned int low, unsigned int up);
+
+        /**
+         * @brief Finds \c nSelected hits nearest in time to the peak of a time-sorted \c hitCluster.
+         * @details The peak is the center of the 200 ns window with the most hits.
+         * If \c nSelected is 0, finds the hits in that window.
+         * The hits are [\c low, \c up) of \c hitCluster.
+         */
+        void FindPeakHits(const PMTHitCluster& hitCluster, unsigned int nSelected, unsigned int& low, unsigned int& up) const;
+
         pmt_geometry* fPMTGeometry;
         likelihood*   fLikelihood;
 
+        // PMT positions at initialization, used by fPMTGeometry
+        std::vector<float> fPMTPositions;
+
+        // fit inputs, reused over fits
+        std::vector<float> fHitT, fHitQ;
+        std::vector<int>   fHitCable;
+        PMTHitCluster      fPeakHits;
+
         float    fFitEnergy;
         float    fFitDirKS;
         float    fFitOvaQ;
+        bool     fIsFitGood;
 
         unsigned int fRefRunNo;
         bool fUseLOWFIT;
         bool fUseSKG4Parameter;
         static bool fIsLOWFITInitialized;
         float waterTransparency;
+
+        // hit selection for large fit windows
+        unsigned int fMaxNHits, fTRMSNHits;
+        TRMSFitManager fTRMSFitManager;
 };
 
 #endif
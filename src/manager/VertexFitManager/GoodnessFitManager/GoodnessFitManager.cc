@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <cmath>
+
+#include "geotnkC.h"
+#include "skheadC.h"
+
+#include "FitCache.hh"
+#include "GoodnessFitManager.hh"
+
+GoodnessFitManager::GoodnessFitManager(Verbosity verbose)
+: VertexFitManager("GoodnessFitManager", verbose),
+INITGRIDWIDTH(800), MINGRIDWIDTH(50), GRIDSHRINKRATE(0.5), VTXMAXRADIUS(5000), MINSTEPWIDTH(5),
+TRESOLUTION(5), TWEIGHTWIDTH(60), NMEANSHIFTS(3), fNEvaluations(0), fTRef(0) {}
+GoodnessFitManager::~GoodnessFitManager() {}
+
+uint64_t GoodnessFitManager::GetSettingsHash() const
+{
+    // PMT positions depend on the SK geometry
+    float settings[] = {INITGRIDWIDTH, MINGRIDWIDTH, GRIDSHRINKRATE, VTXMAXRADIUS, MINSTEPWIDTH,
+                        TRESOLUTION, TWEIGHTWIDTH, float(NMEANSHIFTS), float(skheadg_.sk_geometry)};
+    return FitCache::Hash(settings, sizeof(settings));
+}
+
+float GoodnessFitManager::GetGoodness(const TVector3& vertex, float sigma, float& t0)
+{
+    float vx = vertex.x(), vy = vertex.y(), vz = vertex.z();
+    const float* x = fPMTX.data(); const float* y = fPMTY.data(); const float* z = fPMTZ.data();
+    const float* t = fHitT.data();
+    float* r = fResidual.data();
+    int nHits = fHitT.size();
+    fNEvaluations++;
+
+    // ToF-subtracted hit times
+    float rMin = 1e9, rMax = -1e9;
+    for (int iHit=0; iHit<nHits; iHit++) {
+        float dx = x[iHit] - vx, dy = y[iHit] - vy, dz = z[iHit] - vz;
+        r[iHit] = t[iHit] - std::sqrt(dx*dx + dy*dy + dz*dz) / NTagConstant::C_WATER;
+        rMin = std::min(rMin, r[iHit]);
+        rMax = std::max(rMax, r[iHit]);
+    }
+
+    // start from the 3-bin window of sigma-wide bins with the most hits
+    int nBins = int((rMax - rMin) / sigma) + 1;
+    fTHist.assign(nBins + 2, 0);
+    for (int iHit=0; iHit<nHits; iHit++)
+        fTHist[int((r[iHit] - rMin) / sigma) + 1]++;
+    int peakBin = 1, peakCount = 0;
+    for (int iBin=1; iBin<=nBins; iBin++) {
+        int count = fTHist[iBin-1] + fTHist[iBin] + fTHist[iBin+1];
+        if (count > peakCount) { peakCount = count; peakBin = iBin; }
+    }
+    t0 = rMin + (peakBin - 0.5f) * sigma;
+
+    // hit weight * time likelihood is a Gaussian of this width,
+    // and its weighted mean moves t0 up the numerator of the goodness
+    float aPeak = -0.5f * (1.f/(sigma*sigma) + 1.f/(TWEIGHTWIDTH*TWEIGHTWIDTH));
+    float aWeight = -0.5f / (TWEIGHTWIDTH*TWEIGHTWIDTH);
+    for (int iShift=0; iShift<NMEANSHIFTS; iShift++) {
+        float sumK = 0, sumKR = 0;
+        for (int iHit=0; iHit<nHits; iHit++) {
+            float dt = r[iHit] - t0;
+            float k = std::exp(aPeak * dt * dt);
+            sumK  += k;
+            sumKR += k * dt;
+        }
+        if (sumK > 0) t0 += sumKR / sumK;
+    }
+
+    // goodness: sum of weight * likelihood over sum of weights
+    float numerator = 0, denominator = 0;
+    for (int iHit=0; iHit<nHits; iHit++) {
+        float dt2 = (r[iHit] - t0) * (r[iHit] - t0);
+        numerator   += std::exp(aPeak * dt2);
+        denominator += std::exp(aWeight * dt2);
+    }
+
+    return denominator > 0 ? numerator / denominator : 0;
+}
+
+bool GoodnessFitManager::IsInSearchRange(const TVector3& vertex) const
+{
+    // skip vertex out of tank
+    if (vertex.Perp() > RINTK || std::abs(vertex.z()) > ZPINTK) return false;
+
+    // skip vertex further away from the maximum search range
+    if (vertex.Mag() > VTXMAXRADIUS) return false;
+
+    return true;
+}
+
+void GoodnessFitManager::SearchGrid(const TVector3& gridOrigin, float gridWidth, float gridRLimit, float gridZLimit,
+                                    TVector3& maxPoint, float& maxGoodness, float& maxT0)
+{
+    float sigma = std::max(TRESOLUTION, gridWidth / NTagConstant::C_WATER / 2);
+
+    // goodness is compared at the same time resolution only
+    maxPoint = gridOrigin;
+    maxGoodness = GetGoodness(maxPoint, sigma, maxT0);
+
+    for (float dx=-gridRLimit; dx<gridRLimit+0.1; dx+=gridWidth) {
+        for (float dy=-gridRLimit; dy<gridRLimit+0.1; dy+=gridWidth) {
+            for (float dz=-gridZLimit; dz<gridZLimit+0.1; dz+=gridWidth) {
+                TVector3 gridPoint = gridOrigin + TVector3(dx, dy, dz);
+                if (!IsInSearchRange(gridPoint)) continue;
+
+                float t0;
+                float goodness = GetGoodness(gridPoint, sigma, t0);
+                if (goodness > maxGoodness) {
+                    maxGoodness = goodness;
+                    maxPoint = gridPoint;
+                    maxT0 = t0;
+                }
+            }
+        }
+    }
+}
+
+void GoodnessFitManager::SearchPattern(float stepWidth, TVector3& maxPoint, float& maxGoodness, float& maxT0)
+{
+    const TVector3 axes[3] = {TVector3(1, 0, 0), TVector3(0, 1, 0), TVector3(0, 0, 1)};
+
+    maxGoodness = GetGoodness(maxPoint, TRESOLUTION, maxT0);
+
+    // compass search: move to the best of the 6 neighbors,
+    // or shrink the step if none of them is better
+    while (stepWidth > MINSTEPWIDTH-0.01) {
+        TVector3 center = maxPoint;
+        for (auto const& axis: axes) {
+            for (int sign: {-1, 1}) {
+                TVector3 point = center + sign*stepWidth*axis;
+                if (!IsInSearchRange(point)) continue;
+
+                float t0;
+                float goodness = GetGoodness(point, TRESOLUTION, t0);
+                if (goodness > maxGoodness) {
+                    maxGoodness = goodness;
+                    maxPoint = point;
+                    maxT0 = t0;
+                }
+            }
+        }
+        if (maxPoint == center)
+            stepWidth *= GRIDSHRINKRATE;
+    }
+}
+
+void GoodnessFitManager::Fit(const PMTHitCluster& hitCluster)
+{
+    // hit times relative to the first hit, to keep float precision
+    unsigned int nHits = hitCluster.GetSize();
+    fTRef = nHits ? hitCluster.ConstAt(0).t() + hitCluster.ConstAt(0).GetToF() : 0;
+    fPMTX.resize(nHits); fPMTY.resize(nHits); fPMTZ.resize(nHits); fHitT.resize(nHits);
+    fResidual.resize(nHits);
+    for (unsigned int iHit=0; iHit<nHits; iHit++) {
+        auto const& hit = hitCluster.ConstAt(iHit);
+        auto const& pmtPosition = hit.GetPosition();
+        fPMTX[iHit] = pmtPosition.x();
+        fPMTY[iHit] = pmtPosition.y();
+        fPMTZ[iHit] = pmtPosition.z();
+        fHitT[iHit] = hit.t() + hit.GetToF() - fTRef;
+    }
+    fNEvaluations = 0;
+
+    fFitVertex = TVector3(); fFitTime = 0; fFitGoodness = 0;
+    if (!nHits) return;
+
+    // grid search parameters
+    float gridWidth = INITGRIDWIDTH;
+    float gridRLimit = (int)(2*RINTK/gridWidth)*gridWidth/2.;
+    float gridZLimit = (int)(2*ZPINTK/gridWidth)*gridWidth/2.;
+    TVector3 gridOrigin(0, 0, 0);
+
+    TVector3 maxPoint = gridOrigin;
+    float maxGoodness = 0, maxT0 = 0;
+
+    // shrink the grid around the goodness-maximizing grid point
+    while (gridWidth > MINGRIDWIDTH-0.1) {
+        SearchGrid(gridOrigin, gridWidth, gridRLimit, gridZLimit, maxPoint, maxGoodness, maxT0);
+        gridOrigin = maxPoint;
+        gridWidth *= GRIDSHRINKRATE;
+        gridRLimit *= GRIDSHRINKRATE;
+        gridZLimit *= GRIDSHRINKRATE;
+    }
+
+    // local refinement at the full time resolution
+    SearchPattern(gridWidth, maxPoint, maxGoodness, maxT0);
+
+    fFitVertex = maxPoint;
+    fFitTime = fTRef + maxT0;
+    fFitGoodness = VertexFitManager::GetGoodness(hitCluster, fFitVertex, fFitTime);
+
+    // Form shares one buffer across threads. This is safe only because
+    // EventNTagManager::GetFitWorkers sets the worker copies to pNONE,
+    // so only the fitter on the main thread reaches it.
+    if (fMsg.IsEnabled(pDEBUG))
+        fMsg.Print(Form("Goodness %3.2f at (%3.2f, %3.2f, %3.2f) cm after %d evaluations",
+                        maxGoodness, fFitVertex.x(), fFitVertex.y(), fFitVertex.z(), fNEvaluations), pDEBUG);
+}
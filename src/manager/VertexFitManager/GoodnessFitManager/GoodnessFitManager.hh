@@ -0,0 +1,72 @@
+#ifndef GOODNESSFITMANAGER_HH
+#define GOODNESSFITMANAGER_HH
+
+#include <vector>
+
+#include "VertexFitManager.hh"
+
+/**
+ * @brief Vertex fitter that maximizes the fit goodness of VertexFitManager::GetGoodness.
+ *
+ * @details The vertex is searched on grids shrinking around the best grid point,
+ * as in TRMSFitManager, and refined with a compass search.
+ * The time resolution in the goodness is widened to half the grid width
+ * (in ns of light travel) on coarse grids, so that a coarse grid does not miss
+ * the narrow goodness peak, and is GoodnessFitManager::TRESOLUTION from
+ * the grid width of 2*TRESOLUTION*C_WATER on.
+ * For each vertex, the fit time is taken from a histogram of the ToF-subtracted
+ * hit times and refined with a few mean-shift steps, so that hits are never sorted.
+ * Hits are kept in float arrays, so that each evaluation reads
+ * only the PMT position and the time of each hit.
+ */
+class GoodnessFitManager : public VertexFitManager
+{
+    public:
+        GoodnessFitManager(Verbosity verbose=pDEFAULT);
+        ~GoodnessFitManager();
+
+        void SetParameters(float initgridwidth, float mingridwidth, float gridshrinkrate, float vtxsrcrange, float minstepwidth)
+        {
+            INITGRIDWIDTH = initgridwidth;
+            MINGRIDWIDTH = mingridwidth;
+            GRIDSHRINKRATE = gridshrinkrate;
+            VTXMAXRADIUS = vtxsrcrange;
+            MINSTEPWIDTH = minstepwidth;
+        }
+
+        void Fit(const PMTHitCluster& hitCluster);
+
+        /** Number of goodness evaluations in the last fit. */
+        unsigned int GetNEvaluations() const { return fNEvaluations; }
+
+        uint64_t GetSettingsHash() const;
+
+    private:
+
+        /**
+         * @brief Maximizes the goodness over the fit time at a given vertex.
+         * @param sigma Time resolution (ns) of the goodness.
+         * @param t0 Fit time relative to GoodnessFitManager::fTRef, set to the maximizing time.
+         * @return Goodness at \c vertex and \c t0.
+         */
+        float GetGoodness(const TVector3& vertex, float sigma, float& t0);
+        bool IsInSearchRange(const TVector3& vertex) const;
+
+        void SearchGrid(const TVector3& gridOrigin, float gridWidth, float gridRLimit, float gridZLimit,
+                        TVector3& maxPoint, float& maxGoodness, float& maxT0);
+        void SearchPattern(float stepWidth, TVector3& maxPoint, float& maxGoodness, float& maxT0);
+
+        float INITGRIDWIDTH, MINGRIDWIDTH, GRIDSHRINKRATE, VTXMAXRADIUS, MINSTEPWIDTH;
+        float TRESOLUTION, TWEIGHTWIDTH;
+        int NMEANSHIFTS;
+        unsigned int fNEvaluations;
+
+        // hit PMT positions and hit times without ToF-subtraction
+        std::vector<float> fPMTX, fPMTY, fPMTZ, fHitT;
+        // buffers for GoodnessFitManager::GetGoodness
+        std::vector<float> fResidual;
+        std::vector<int> fTHist;
+        Float fTRef;
+};
+
+#endif
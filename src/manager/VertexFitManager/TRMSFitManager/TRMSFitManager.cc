@@ -1,55 +1,163 @@
+#include <algorithm>
+#include <cmath>
+
 #include "geotnkC.h"
+#include "skheadC.h"
 
+#include "FitCache.hh"
 #include "TRMSFitManager.hh"
 
 TRMSFitManager::TRMSFitManager(Verbosity verbose)
 : VertexFitManager("TRMSFitManager", verbose),
-INITGRIDWIDTH(800), MINGRIDWIDTH(50), GRIDSHRINKRATE(0.5), VTXMAXRADIUS(5000) {}
+INITGRIDWIDTH(800), MINGRIDWIDTH(50), GRIDSHRINKRATE(0.5), VTXMAXRADIUS(5000),
+MINSTEPWIDTH(5), STARTRADIUS(500), fMinimizer(mGridSearch), fStart(mTankCenter),
+fNEvaluations(0), fTRef(0) {}
 TRMSFitManager::~TRMSFitManager() {}
 
-void TRMSFitManager::Fit(const PMTHitCluster& hitCluster)
+uint64_t TRMSFitManager::GetSettingsHash() const
 {
-    // copy hit cluster
-    auto cluster = hitCluster;
+    // PMT positions depend on the SK geometry, and the prompt vertex is hashed
+    // for every start so that fits with different prompt vertex modes are never mixed
+    float settings[] = {INITGRIDWIDTH, MINGRIDWIDTH, GRIDSHRINKRATE, VTXMAXRADIUS, MINSTEPWIDTH, STARTRADIUS,
+                        float(fMinimizer), float(fStart), float(skheadg_.sk_geometry),
+                        float(fPromptVertex.x()), float(fPromptVertex.y()), float(fPromptVertex.z())};
+    return FitCache::Hash(settings, sizeof(settings));
+}
 
-    // grid search parameters
-    float gridWidth = INITGRIDWIDTH;
-    float gridRLimit = (int)(2*RINTK/gridWidth)*gridWidth/2.;
-    float gridZLimit = (int)(2*ZPINTK/gridWidth)*gridWidth/2.;
-    TVector3 gridOrigin(0, 0, 0); // grid origin in the grid search loop (starts at tank center)
-    TVector3 minGridPoint;        // temp point to save TRMS-minimizing grid point
-    TVector3 gridPoint;           // point in grid to find TRMS
+void TRMSFitManager::SumToFSubtractedT(const TVector3& vertex, double& sumT, double& sumT2) const
+{
+    double vx = vertex.x(), vy = vertex.y(), vz = vertex.z();
+    const float* x = fPMTX.data(); const float* y = fPMTY.data(); const float* z = fPMTZ.data();
+    const float* t = fHitT.data();
+    unsigned int nHits = fHitT.size();
 
-    float minTRMS = 9999.; float tRMS;
+    // no sort needed for RMS: a single pass over the arrays
+    sumT = 0; sumT2 = 0;
+    for (unsigned int iHit=0; iHit<nHits; iHit++) {
+        double dx = x[iHit] - vx, dy = y[iHit] - vy, dz = z[iHit] - vz;
+        Float tof = sqrt(dx*dx + dy*dy + dz*dz) / NTagConstant::C_WATER;
+        double hitT = t[iHit] - tof;
+        sumT  += hitT;
+        sumT2 += hitT * hitT;
+    }
+}
 
-    // repeat until grid width gets small enough
-    while (gridWidth > MINGRIDWIDTH-0.1) {
+float TRMSFitManager::GetTRMS(const TVector3& vertex)
+{
+    // RMS of ToF-subtracted hit times from the vertex (same as Calc::RMS)
+    double sumT, sumT2;
+    unsigned int nHits = fHitT.size();
+    SumToFSubtractedT(vertex, sumT, sumT2);
+    fNEvaluations++;
+    return sqrt((sumT2 - sumT*sumT/nHits) / (nHits-1));
+}
 
-        // allocate coordinates to a grid point
-        for (float dx=-gridRLimit; dx<gridRLimit+0.1; dx+=gridWidth) {
-            for (float dy=-gridRLimit; dy<gridRLimit+0.1; dy+=gridWidth) {
-                for (float dz=-gridZLimit; dz<gridZLimit+0.1; dz+=gridWidth) {
-                    TVector3 displacement(dx, dy, dz);
-                    gridPoint = gridOrigin + displacement;
+bool TRMSFitManager::IsInSearchRange(const TVector3& vertex) const
+{
+    // skip vertex out of tank
+    if (vertex.Perp() > RINTK || abs(vertex.z()) > ZPINTK) return false;
+
+    // skip vertex further away from the maximum search range
+    if (vertex.Mag() > VTXMAXRADIUS) return false;
+
+    return true;
+}
+
+void TRMSFitManager::SearchGrid(const TVector3& gridOrigin, float gridWidth, float gridRLimit, float gridZLimit,
+                                TVector3& minPoint, float& minTRMS)
+{
+    TVector3 gridPoint; // point in grid to find TRMS
+    float tRMS;
+
+    // allocate coordinates to a grid point
+    for (float dx=-gridRLimit; dx<gridRLimit+0.1; dx+=gridWidth) {
+        for (float dy=-gridRLimit; dy<gridRLimit+0.1; dy+=gridWidth) {
+            for (float dz=-gridZLimit; dz<gridZLimit+0.1; dz+=gridWidth) {
+                TVector3 displacement(dx, dy, dz);
+                gridPoint = gridOrigin + displacement;
 
-                    // skip grid point out of tank
-                    if (gridPoint.Perp() > RINTK || abs(gridPoint.z()) > ZPINTK) continue;
+                if (!IsInSearchRange(gridPoint)) continue;
+
+                tRMS = GetTRMS(gridPoint);
+
+                // save TRMS minimizing grid point
+                if (tRMS < minTRMS) {
+                    minTRMS = tRMS;
+                    minPoint = gridPoint;
+                }
+            }
+        }
+    }
+}
 
-                    // skip grid point further away from the maximum search range
-                    if (gridPoint.Mag() > VTXMAXRADIUS) continue;
+void TRMSFitManager::SearchPattern(float stepWidth, TVector3& minPoint, float& minTRMS)
+{
+    const TVector3 axes[3] = {TVector3(1, 0, 0), TVector3(0, 1, 0), TVector3(0, 0, 1)};
 
-                    // subtract ToF from the search vertex
-                    cluster.SetVertex(gridPoint);
-                    tRMS = cluster.Find(HitFunc::T, Calc::RMS);
+    // compass search: move to the best of the 6 neighbors,
+    // or shrink the step if none of them is better
+    while (stepWidth > MINSTEPWIDTH-0.01) {
+        TVector3 center = minPoint;
+        for (auto const& axis: axes) {
+            for (int sign: {-1, 1}) {
+                TVector3 point = center + sign*stepWidth*axis;
+                if (!IsInSearchRange(point)) continue;
 
-                    // save TRMS minimizing grid point
-                    if (tRMS < minTRMS) {
-                        minTRMS = tRMS;
-                        minGridPoint = gridPoint;
-                    }
+                float tRMS = GetTRMS(point);
+                if (tRMS < minTRMS) {
+                    minTRMS = tRMS;
+                    minPoint = point;
                 }
             }
         }
+        if (minPoint == center)
+            stepWidth *= GRIDSHRINKRATE;
+    }
+}
+
+void TRMSFitManager::Fit(const PMTHitCluster& hitCluster)
+{
+    // hit times relative to the first hit, to keep the sums small
+    unsigned int nHits = hitCluster.GetSize();
+    fTRef = nHits ? hitCluster.ConstAt(0).t() + hitCluster.ConstAt(0).GetToF() : 0;
+    fPMTX.resize(nHits); fPMTY.resize(nHits); fPMTZ.resize(nHits); fHitT.resize(nHits);
+    TVector3 hitCentroid;
+    for (unsigned int iHit=0; iHit<nHits; iHit++) {
+        auto const& hit = hitCluster.ConstAt(iHit);
+        auto const& pmtPosition = hit.GetPosition();
+        fPMTX[iHit] = pmtPosition.x();
+        fPMTY[iHit] = pmtPosition.y();
+        fPMTZ[iHit] = pmtPosition.z();
+        fHitT[iHit] = hit.t() + hit.GetToF() - fTRef;
+        hitCentroid += pmtPosition;
+    }
+    if (nHits) hitCentroid *= 1./nHits;
+    fNEvaluations = 0;
+
+    // grid search parameters
+    float gridWidth = INITGRIDWIDTH;
+    float gridRLimit = (int)(2*RINTK/gridWidth)*gridWidth/2.;
+    float gridZLimit = (int)(2*ZPINTK/gridWidth)*gridWidth/2.;
+    TVector3 gridOrigin(0, 0, 0); // grid origin in the grid search loop (starts at tank center)
+
+    TVector3 minGridPoint = gridOrigin; // temp point to save TRMS-minimizing grid point
+    float minTRMS = 9999.;
+
+    // warm start: smaller grid around a vertex estimate,
+    // with an odd number of points per axis so that the estimate itself is a grid point
+    if (fStart != mTankCenter) {
+        gridOrigin = (fStart == mPromptVertex) ? fPromptVertex : hitCentroid;
+        gridWidth = std::min(INITGRIDWIDTH, STARTRADIUS/2);
+        gridRLimit = gridZLimit = (int)(STARTRADIUS/gridWidth)*gridWidth;
+
+        minGridPoint = gridOrigin;
+        if (IsInSearchRange(gridOrigin))
+            minTRMS = GetTRMS(gridOrigin);
+    }
+
+    // repeat until grid width gets small enough
+    while (gridWidth > MINGRIDWIDTH-0.1) {
+        SearchGrid(gridOrigin, gridWidth, gridRLimit, gridZLimit, minGridPoint, minTRMS);
 
         // change grid origin to the TRMS-minimizing grid point,
         // shorten the grid width,
@@ -58,11 +166,25 @@ void TRMSFitManager::Fit(const PMTHitCluster& hitCluster)
         gridWidth *= GRIDSHRINKRATE;
         gridRLimit *= GRIDSHRINKRATE;
         gridZLimit *= GRIDSHRINKRATE;
+
+        // pattern search refines the first grid level
+        if (fMinimizer == mPatternSearch) break;
     }
 
+    if (fMinimizer == mPatternSearch)
+        SearchPattern(gridWidth, minGridPoint, minTRMS);
+
     fFitVertex = minGridPoint;
-    cluster.SetVertex(fFitVertex);
-    fFitTime = cluster.Find(HitFunc::T, Calc::Mean);
+    double sumT, sumT2;
+    SumToFSubtractedT(fFitVertex, sumT, sumT2);
+    fFitTime = nHits ? fTRef + sumT/nHits : 0;
+
+    fFitGoodness = GetGoodness(hitCluster, fFitVertex, fFitTime);
 
-    fFitGoodness = GetGoodness(cluster, fFitVertex, fFitTime);
-}
\ No newline at end of file
+    // Only the main-thread fitter gets past this check. TRMS workers, and
+    // the TRMS fitter inside each BONSAI worker, run at pNONE, so the
+    // non-reentrant Form is never called from two threads at once.
+    if (fMsg.IsEnabled(pDEBUG))
+        fMsg.Print(Form("TRMS %3.2f ns at (%3.2f, %3.2f, %3.2f) cm after %d evaluations",
+                        minTRMS, fFitVertex.x(), fFitVertex.y(), fFitVertex.z(), fNEvaluations), pDEBUG);
+}
@@ -1,8 +1,23 @@
 #ifndef TRMSFITMANAGER_HH
 #define TRMSFITMANAGER_HH
 
+#include <vector>
+
 #include "VertexFitManager.hh"
 
+enum TRMSMinimizer
+{
+    mGridSearch,   ///< Grid search shrunk down to MINGRIDWIDTH
+    mPatternSearch ///< One coarse grid level followed by a compass pattern search down to MINSTEPWIDTH
+};
+
+enum TRMSStart
+{
+    mTankCenter,   ///< Grid over the whole tank
+    mPromptVertex, ///< Grid within STARTRADIUS from the prompt vertex
+    mHitCentroid   ///< Grid within STARTRADIUS from the centroid of hit PMTs
+};
+
 class TRMSFitManager : public VertexFitManager
 {
     public:
@@ -17,10 +32,53 @@ class TRMSFitManager : public VertexFitManager
             VTXMAXRADIUS = vtxsrcrange;
         }
 
+        /**
+         * @brief Sets the minimization strategy.
+         * @param minimizer One of #TRMSMinimizer.
+         * @param minstepwidth Final step width of #mPatternSearch (cm).
+         */
+        void SetMinimizer(TRMSMinimizer minimizer, float minstepwidth=5) { fMinimizer = minimizer; MINSTEPWIDTH = minstepwidth; }
+
+        /**
+         * @brief Sets where the first grid is placed.
+         * @param start One of #TRMSStart.
+         * @param startradius Half width of the first grid for #mPromptVertex and #mHitCentroid (cm).
+         * The first grid width is then the smaller of INITGRIDWIDTH and \c startradius/2.
+         */
+        void SetStart(TRMSStart start, float startradius=500) { fStart = start; STARTRADIUS = startradius; }
+        void SetPromptVertex(const TVector3& promptVertex) { fPromptVertex = promptVertex; }
+
         void Fit(const PMTHitCluster& hitCluster);
 
+        /** Number of TRMS evaluations in the last fit. */
+        unsigned int GetNEvaluations() const { return fNEvaluations; }
+
+        uint64_t GetSettingsHash() const;
+
     private:
+
+        /**
+         * @brief Sums of ToF-subtracted hit times and their squares from a given vertex.
+         * @details Hit times are relative to TRMSFitManager::fTRef.
+         */
+        void SumToFSubtractedT(const TVector3& vertex, double& sumT, double& sumT2) const;
+        float GetTRMS(const TVector3& vertex);
+        bool IsInSearchRange(const TVector3& vertex) const;
+
+        void SearchGrid(const TVector3& gridOrigin, float gridWidth, float gridRLimit, float gridZLimit,
+                        TVector3& minPoint, float& minTRMS);
+        void SearchPattern(float stepWidth, TVector3& minPoint, float& minTRMS);
+
         float INITGRIDWIDTH, MINGRIDWIDTH, GRIDSHRINKRATE, VTXMAXRADIUS;
+        float MINSTEPWIDTH, STARTRADIUS;
+        TRMSMinimizer fMinimizer;
+        TRMSStart fStart;
+        TVector3 fPromptVertex;
+        unsigned int fNEvaluations;
+
+        // hit PMT positions and hit times without ToF-subtraction
+        std::vector<float> fPMTX, fPMTY, fPMTZ, fHitT;
+        Float fTRef;
 };
 
-#endif
\ No newline at end of file
+#endif
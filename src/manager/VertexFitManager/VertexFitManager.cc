@@ -1,7 +1,32 @@
-#include <math.h>
+#include <cmath>
 
+#include "FitCache.hh"
 #include "VertexFitManager.hh"
 
+uint64_t VertexFitManager::GetCacheKey(const PMTHitCluster& hitCluster, uint64_t& checkKey) const
+{
+    uint64_t key = FitCache::Hash(fFitterName.data(), fFitterName.size());
+    checkKey = FitCache::Hash(fFitterName.data(), fFitterName.size(), FitCache::CHECKSEED);
+    uint64_t settingsHash = GetSettingsHash();
+    key = FitCache::Hash(&settingsHash, sizeof(settingsHash), key);
+    checkKey = FitCache::Hash(&settingsHash, sizeof(settingsHash), checkKey);
+
+    // fitters read hit times without ToF, which depends on the vertex set to the hits
+    for (auto const& hit: hitCluster) {
+        Float t = hit.t() + hit.GetToF();
+        float q = hit.q();
+        int   i = hit.i();
+        key = FitCache::Hash(&t, sizeof(t), key);
+        key = FitCache::Hash(&q, sizeof(q), key);
+        key = FitCache::Hash(&i, sizeof(i), key);
+        checkKey = FitCache::Hash(&t, sizeof(t), checkKey);
+        checkKey = FitCache::Hash(&q, sizeof(q), checkKey);
+        checkKey = FitCache::Hash(&i, sizeof(i), checkKey);
+    }
+
+    return key;
+}
+
 float VertexFitManager::GetGoodness(const PMTHitCluster& hitCluster, const TVector3& vertex, const float& t0)
 {
     if (hitCluster.IsEmpty()) {
@@ -9,24 +34,57 @@ float VertexFitManager::GetGoodness(const PMTHitCluster& hitCluster, const TVect
         return 0;
     }
 
-    auto cluster = hitCluster;
-    cluster.SetVertex(vertex);
+    static thread_local std::vector<TVector3> vertices(1);
+    static thread_local std::vector<float> t0s(1), goodness(1);
+    vertices[0] = vertex;
+    t0s[0] = t0;
+    GetGoodness(hitCluster.begin(), hitCluster.end(), vertices, t0s, goodness);
+
+    return goodness[0];
+}
 
-    float numerator = 0;
-    float denominator = 0;
-    for (auto const& hit: cluster) {
-        float w_hit = exp(-0.5 * pow(((hit.t() - t0) / 60.), 2));       // hit weight
-        numerator += w_hit * exp(-0.5 * pow(((hit.t() - t0) / 5.), 2)); // numerator: sum of weight * effective likelihood
-        denominator += w_hit;                                           // denominator: sum of weights
+void VertexFitManager::GetGoodness(std::vector<PMTHit>::const_iterator begin, std::vector<PMTHit>::const_iterator end,
+                                   const std::vector<TVector3>& vertices, const std::vector<float>& t0s, std::vector<float>& goodness)
+{
+    // hit PMT positions and hit times without ToF-subtraction,
+    // kept per thread so that no memory is allocated once they are large enough
+    static thread_local std::vector<float> pmtX, pmtY, pmtZ, hitT;
+    unsigned int nHits = end - begin;
+    pmtX.resize(nHits); pmtY.resize(nHits); pmtZ.resize(nHits); hitT.resize(nHits);
+    for (unsigned int iHit=0; iHit<nHits; iHit++) {
+        auto const& hit = *(begin + iHit);
+        auto const& pmtPosition = hit.GetPosition();
+        pmtX[iHit] = pmtPosition.x();
+        pmtY[iHit] = pmtPosition.y();
+        pmtZ[iHit] = pmtPosition.z();
+        hitT[iHit] = hit.t() + hit.GetToF();
     }
 
-    float goodness = numerator/denominator;
+    // hit weight: a Gaussian of 60 ns width, effective likelihood: a Gaussian of 5 ns width
+    const float aWeight = -0.5 / (60.*60.);
+    const float aLikelihood = -0.5 / (5.*5.);
 
-    if (isnan(goodness)) {
-        std::cerr << "WARNING: Vertex fit goodness is NaN! returning 0...\n";
-        return 0;
-    }
-    else {
-        return goodness;
+    goodness.resize(vertices.size());
+    for (unsigned int iVertex=0; iVertex<vertices.size(); iVertex++) {
+        float vx = vertices[iVertex].x(), vy = vertices[iVertex].y(), vz = vertices[iVertex].z();
+        float t0 = t0s[iVertex];
+
+        float numerator = 0;
+        float denominator = 0;
+        for (unsigned int iHit=0; iHit<nHits; iHit++) {
+            float dx = pmtX[iHit] - vx, dy = pmtY[iHit] - vy, dz = pmtZ[iHit] - vz;
+            float tof = std::sqrt(dx*dx + dy*dy + dz*dz) / NTagConstant::C_WATER;
+            float dt2 = (hitT[iHit] - tof - t0) * (hitT[iHit] - tof - t0);
+            float w_hit = std::exp(aWeight * dt2);              // hit weight
+            numerator += w_hit * std::exp(aLikelihood * dt2);  // numerator: sum of weight * effective likelihood
+            denominator += w_hit;                              // denominator: sum of weights
+        }
+
+        goodness[iVertex] = numerator/denominator;
+
+        if (std::isnan(goodness[iVertex])) {
+            std::cerr << "WARNING: Vertex fit goodness is NaN! returning 0...\n";
+            goodness[iVertex] = 0;
+        }
     }
 }
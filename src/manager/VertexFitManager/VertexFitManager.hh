@@ -5,6 +5,9 @@
 #ifndef VERTEXFITMANAGER_HH
 #define VERTEXFITMANAGER_HH
 
+#include <cstdint>
+#include <vector>
+
 #include "TVector3.h"
 #include "PMTHitCluster.hh"
 #include "Printer.hh"
@@ -16,7 +19,7 @@ class VertexFitManager
 {
     public:
         VertexFitManager(const char* fitterName, Verbosity verbose=pDEFAULT)
-        : fFitVertex(), fFitTime(0), fFitGoodness(0), fMsg(fitterName, verbose) {}
+        : fFitVertex(), fFitTime(0), fFitGoodness(0), fFitterName(fitterName), fMsg(fitterName, verbose) {}
 
         virtual void Fit(const PMTHitCluster& hitCluster) = 0;
         TVector3 GetFitVertex() { return fFitVertex; }
@@ -24,16 +27,46 @@ class VertexFitManager
         float GetFitGoodness() { return fFitGoodness; }
         void SetVerbosity(Verbosity verbose) { fMsg.SetVerbosity(verbose); }
 
+        /**
+         * @brief Returns \c true if different instances of the fitter can fit concurrently on different threads.
+         * @details Fitters that use global state, e.g., Fortran common blocks, should return \c false.
+         */
+        virtual bool IsThreadSafe() const { return true; }
+
+        /**
+         * @brief Returns the FitCache key of a fit to \c hitCluster.
+         * @details Hash of the fitter name, VertexFitManager::GetSettingsHash, and the time
+         * without ToF-subtraction, charge, and PMT ID of all hits.
+         * @param checkKey Set to the hash of the same inputs from FitCache::CHECKSEED.
+         */
+        uint64_t GetCacheKey(const PMTHitCluster& hitCluster, uint64_t& checkKey) const;
+
+        /**
+         * @brief Returns a hash of the fitter settings that change fit results.
+         */
+        virtual uint64_t GetSettingsHash() const { return 0; }
+
         /**
          * @brief Calculate ad-hoc vertex fit goodness.
+         * @details Hit times are ToF-subtracted from \c vertex on the fly, so \c hitCluster is not copied or sorted.
          */
         static float GetGoodness(const PMTHitCluster& hitCluster, const TVector3& vertex, const float& t0);
 
+        /**
+         * @brief Calculate ad-hoc vertex fit goodness of hits in [\c begin, \c end) for each of \c vertices.
+         * @param t0s Fit time for each of \c vertices.
+         * @param goodness Goodness for each of \c vertices.
+         */
+        static void GetGoodness(std::vector<PMTHit>::const_iterator begin, std::vector<PMTHit>::const_iterator end,
+                                const std::vector<TVector3>& vertices, const std::vector<float>& t0s, std::vector<float>& goodness);
+
     protected:
         TVector3 fFitVertex;
         float    fFitTime;
         float    fFitGoodness;
 
+        std::string fFitterName;
+
         Printer fMsg;
 };
 
@@ -11,8 +11,7 @@
 #include <TSystemDirectory.h>
 #include <TSystemFile.h>
 
-#include <geotnkC.h>
-
+#include "SKGeometry.hh"
 #include "Calculator.hh"
 
 std::default_random_engine c_ranGen;
@@ -113,28 +112,17 @@ float GetOpeningAngle(TVector3 uA, TVector3 uB, TVector3 uC)
     }
 }
 
-float GetDWall(TVector3 vtx)
+float GetDWall(const TVector3& vtx)
 {
-    float vertex[3] = {(float)vtx.x(), (float)vtx.y(), (float)vtx.z()};
-    return wallsk_(vertex);
+    return SKGeometry::GetDWall(vtx.x(), vtx.y(), vtx.z());
 }
 
-float GetDWallInDirection(TVector3 vtx, TVector3 dir)
+float GetDWallInDirection(const TVector3& vtx, const TVector3& dir)
 {
     assert(dir.Mag()>0);
-    dir = dir.Unit();
-
-    float dot = vtx.Dot(dir) - vtx.z()*dir.z();
-    float dirSq = dir.Perp2(); float vtxSq = vtx.Perp2();
-    //float dirx = dir.x(); float diry = dir.y(); float dirz = dir.z();
-
-    // Calculate distance to barrel and distance to top/bottom
-    float distR = fabs((-dot + sqrt(dot*dot + dirSq*(RINTK*RINTK - vtxSq))) / dirSq);
-    float distZ = fabs(dir.z() > 0 ? (ZPINTK-vtx.z())/dir.z() : (ZMINTK-vtx.z())/dir.z());
+    TVector3 unitDir = dir.Unit();
 
-    // Return the smaller
-    if (std::isnan(distZ)) return distR;
-    else return  distR < distZ ? distR : distZ;
+    return SKGeometry::GetDWallInDirection(vtx.x(), vtx.y(), vtx.z(), unitDir.x(), unitDir.y(), unitDir.z());
 }
 
 unsigned int GetMinIndex(std::vector<float>& vec)
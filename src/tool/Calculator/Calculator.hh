@@ -223,14 +223,14 @@ float GetOpeningAngle(TVector3 uA, TVector3 uB, TVector3 uC);
  * @param dir The input direction vertex.
  * @return The distance to the wall in the given direction in cm.
  */
-float GetDWallInDirection(TVector3 vtx, TVector3 dir);
+float GetDWallInDirection(const TVector3& vtx, const TVector3& dir);
 
 /**
  * @brief Calculates the nearest distance to the SK tank wall.
  * @param vtx The input vertex with SK x, y, z coordinates in cm.
  * @return The nearest distance to the wall in cm.
  */
-float GetDWall(TVector3 vtx);
+float GetDWall(const TVector3& vtx);
 
 /**
  * @brief Returns the index of the minimum value in a given vector.
@@ -0,0 +1,36 @@
+#include <cmath>
+
+#include <skbadcC.h>
+#undef MAXPM
+#undef MAXPMA
+
+#include "SKIO.hh"
+#include "DarkRateTable.hh"
+
+// fraction of dark hits assumed to be flat in time (not bursts)
+static const float FLATDARKRATIO = 0.5;
+
+int DarkRateTable::fVersion = -1;
+std::vector<float> DarkRateTable::fLogRatio;
+std::vector<bool>  DarkRateTable::fIsNoisy;
+std::vector<float> DarkRateTable::fBurstRate;
+
+void DarkRateTable::Update()
+{
+    if (fVersion == SKIO::GetDarkRateVersion() && !fLogRatio.empty()) return;
+
+    const int nPMTs = sizeof(comdark_.dark_rate) / sizeof(comdark_.dark_rate[0]);
+    fLogRatio.resize(nPMTs);
+    fIsNoisy.resize(nPMTs);
+    fBurstRate.resize(nPMTs);
+
+    float darkAve = comdark_.dark_ave;
+    for (int iPMT = 0; iPMT < nPMTs; iPMT++) {
+        float darkRate = comdark_.dark_rate[iPMT];
+        fLogRatio[iPMT]  = std::log(darkRate / darkAve);
+        fIsNoisy[iPMT]   = darkRate > darkAve;
+        fBurstRate[iPMT] = darkRate * FLATDARKRATIO * 1e-6;
+    }
+
+    fVersion = SKIO::GetDarkRateVersion();
+}
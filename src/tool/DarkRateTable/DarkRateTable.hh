@@ -0,0 +1,60 @@
+/*******************************************
+*
+* @file DarkRateTable.hh
+*
+* @brief Defines DarkRateTable.
+*
+********************************************/
+
+#ifndef DARKRATETABLE_HH
+#define DARKRATETABLE_HH
+
+#include <vector>
+
+/********************************************************
+ * @brief Per-PMT quantities derived from the dark rates
+ * in \c comdark_, used for the dark-noise features of
+ * PMTHitCluster.
+ *
+ * @details The tables are rebuilt by
+ * DarkRateTable::Update only if SKIO reports that the
+ * dark rate tables have changed since the last build,
+ * so in most cases once per run.
+ * Indices are PMT cable numbers (starting from 1).
+ * The tables are static and not locked: call
+ * DarkRateTable::Update, and the PMTHitCluster methods that
+ * use it, only from the main thread, which also owns
+ * \c comdark_.
+ *******************************************************/
+class DarkRateTable
+{
+    public:
+        /**
+         * @brief Rebuilds the tables if the dark rates in \c comdark_ have changed.
+         * @details Not thread-safe: main thread only.
+         */
+        static void Update();
+
+        /**
+         * @brief Log of the dark rate ratio to the average dark rate.
+         */
+        static float GetLogRatio(int pmtID) { return fLogRatio[pmtID-1]; }
+
+        /**
+         * @brief Returns \c true if the dark rate is larger than the average dark rate.
+         */
+        static bool IsNoisy(int pmtID) { return fIsNoisy[pmtID-1]; }
+
+        /**
+         * @brief Expected number of burst hits per ns of burst window.
+         */
+        static float GetBurstRate(int pmtID) { return fBurstRate[pmtID-1]; }
+
+    private:
+        static int fVersion;
+        static std::vector<float> fLogRatio;
+        static std::vector<bool>  fIsNoisy;
+        static std::vector<float> fBurstRate;
+};
+
+#endif
@@ -0,0 +1,116 @@
+#include <cstring>
+
+#include <unistd.h>
+
+#include "FitCache.hh"
+
+static const char FITCACHEMAGIC[8] = "NTAGFTC";
+
+FitCache::FitCache()
+: fFile(nullptr), fNLookups(0), fNFound(0), fNCollisions(0), fBytesRead(0), fBytesWritten(0) {}
+
+FitCache::~FitCache()
+{
+    Close();
+}
+
+bool FitCache::Open(std::string filePath)
+{
+    Close();
+    fNLookups = 0; fNFound = 0; fNCollisions = 0;
+    fBytesRead = 0; fBytesWritten = 0;
+
+    FitCacheHeader header = {};
+    memcpy(header.magic, FITCACHEMAGIC, sizeof(FITCACHEMAGIC));
+    header.version = VERSION;
+    header.recordSize = sizeof(FitCacheRecord);
+
+    FILE* file = fopen(filePath.c_str(), "rb");
+
+    // new cache
+    if (!file) {
+        fFile = fopen(filePath.c_str(), "wb");
+        if (!fFile || fwrite(&header, sizeof(header), 1, fFile) != 1) {
+            Close();
+            return false;
+        }
+    }
+
+    // existing cache: read all records
+    else {
+        FitCacheHeader fileHeader;
+        bool isValid = fread(&fileHeader, sizeof(fileHeader), 1, file) == 1
+                       && !memcmp(fileHeader.magic, FITCACHEMAGIC, sizeof(FITCACHEMAGIC))
+                       && fileHeader.version == VERSION && fileHeader.recordSize == header.recordSize;
+
+        uint64_t nRecords = 0;
+        FitCacheRecord record;
+        while (isValid && fread(&record, sizeof(record), 1, file) == 1) {
+            fRecords[record.key] = record;
+            nRecords++;
+        }
+        fclose(file);
+
+        // a partial record left by an interrupted job is dropped
+        fBytesRead = sizeof(header) + nRecords * sizeof(FitCacheRecord);
+        if (!isValid || truncate(filePath.c_str(), fBytesRead) < 0
+            || !(fFile = fopen(filePath.c_str(), "ab"))) {
+            Close();
+            return false;
+        }
+    }
+
+    fFilePath = filePath;
+
+    return true;
+}
+
+void FitCache::Close()
+{
+    if (fFile) fclose(fFile);
+    fFile = nullptr;
+    fFilePath.clear();
+    fRecords.clear();
+}
+
+bool FitCache::Find(uint64_t key, uint64_t checkKey, uint32_t nHits, FitCacheRecord& record)
+{
+    fNLookups++;
+
+    auto found = fRecords.find(key);
+    if (found == fRecords.end()) return false;
+
+    // same key from a different fit window
+    if (found->second.checkKey != checkKey || found->second.nHits != nHits) {
+        fNCollisions++;
+        return false;
+    }
+
+    record = found->second;
+    fNFound++;
+    return true;
+}
+
+void FitCache::Add(const FitCacheRecord& record)
+{
+    if (!fFile) return;
+
+    // the last record of a key is kept when the file is read again
+    auto found = fRecords.find(record.key);
+    if (found != fRecords.end() && found->second.checkKey == record.checkKey && found->second.nHits == record.nHits)
+        return;
+
+    fRecords[record.key] = record;
+    if (fwrite(&record, sizeof(record), 1, fFile) == 1)
+        fBytesWritten += sizeof(record);
+}
+
+uint64_t FitCache::Hash(const void* data, size_t nBytes, uint64_t hash)
+{
+    auto bytes = (const unsigned char*)data;
+    for (size_t i=0; i<nBytes; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
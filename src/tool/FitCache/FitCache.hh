@@ -0,0 +1,107 @@
+/*******************************************
+*
+* @file FitCache.hh
+*
+* @brief Defines FitCache.
+*
+********************************************/
+
+#ifndef FITCACHE_HH
+#define FITCACHE_HH
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+/******************************************
+* @brief File header of a fit cache.
+*******************************************/
+struct FitCacheHeader
+{
+    char     magic[8];   ///< "NTAGFTC" + null
+    uint32_t version;
+    uint32_t recordSize; ///< Size of FitCacheRecord in bytes
+};
+
+/******************************************
+* @brief One vertex fit result in a fit cache.
+*******************************************/
+struct FitCacheRecord
+{
+    uint64_t key;       ///< See VertexFitManager::GetCacheKey
+    uint64_t checkKey;  ///< Second hash of the same inputs, checked on lookup
+    double   vertex[3];
+    float    time;      ///< Fit time in the fit window (ns)
+    float    goodness;
+    float    aux[3];    ///< Fitter-specific outputs, e.g., BONSAI energy, dirKS, and ovaQ
+    uint32_t nHits;     ///< Number of hits in the fit window, checked on lookup
+};
+
+/********************************************************
+ * @brief On-disk cache of vertex fit results.
+ *
+ * @details A fit cache is a flat binary file of
+ * FitCacheRecord, each keyed by a hash of the fitter
+ * settings and the hits in the fit window. All records
+ * are read at FitCache::Open, and new records are
+ * appended to the same file, so that later jobs on
+ * the same input can skip fits that were already done.
+ *******************************************************/
+class FitCache
+{
+    public:
+        FitCache();
+        ~FitCache();
+
+        /**
+         * @brief Reads the records in the cache file at \c filePath, and opens it for appending.
+         * @details A new cache file is made if none exists.
+         * @return \c false if the file cannot be opened or is not a valid fit cache.
+         */
+        bool Open(std::string filePath);
+        void Close();
+        bool IsOpen() const { return fFile != nullptr; }
+
+        /**
+         * @brief Looks up \c key.
+         * @details A record under \c key with a different \c checkKey or \c nHits
+         * is a hash collision of a different fit window, and is not returned.
+         * @return \c true if found, with the result in \c record.
+         */
+        bool Find(uint64_t key, uint64_t checkKey, uint32_t nHits, FitCacheRecord& record);
+
+        /**
+         * @brief Adds a record and appends it to the file.
+         * @details A colliding record under the same key is replaced.
+         */
+        void Add(const FitCacheRecord& record);
+
+        const std::string& GetFilePath() const { return fFilePath; }
+        unsigned long GetNRecords() const { return fRecords.size(); }
+        unsigned long GetNLookups() const { return fNLookups; }
+        unsigned long GetNFound() const { return fNFound; }
+        unsigned long GetNCollisions() const { return fNCollisions; }
+        unsigned long GetBytesRead() const { return fBytesRead; }
+        unsigned long GetBytesWritten() const { return fBytesWritten; }
+
+        /**
+         * @brief 64-bit FNV-1a hash of \c nBytes bytes from \c data.
+         * @param hash Hash to continue from, for hashing multiple inputs.
+         */
+        static uint64_t Hash(const void* data, size_t nBytes, uint64_t hash=HASHSEED);
+
+        static const uint64_t HASHSEED = 14695981039346656037ULL;
+        static const uint64_t CHECKSEED = 0x9e3779b97f4a7c15ULL; ///< Seed of FitCacheRecord::checkKey
+        static const uint32_t VERSION = 2;
+
+    private:
+        FILE* fFile;
+        std::string fFilePath;
+        std::unordered_map<uint64_t, FitCacheRecord> fRecords;
+
+        unsigned long fNLookups, fNFound, fNCollisions;
+        unsigned long fBytesRead, fBytesWritten;
+};
+
+#endif
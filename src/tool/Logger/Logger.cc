@@ -0,0 +1,202 @@
+#include <iostream>
+#include <sstream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include <unistd.h>
+
+#include "Logger.hh"
+
+static const unsigned int MAXQUEUESIZE = 10000;
+
+bool Logger::fIsEnabled[nCATEGORIES] = {true, true, true, true, true, true};
+float Logger::fMaxRate = 0;
+double Logger::fWindowStart[nCATEGORIES] = {0};
+unsigned int Logger::fNWritten[nCATEGORIES] = {0};
+unsigned int Logger::fNDropped[nCATEGORIES] = {0};
+
+bool Logger::fIsAsync = false;
+bool Logger::fDoStop = false;
+bool Logger::fIsWriting = false;
+int Logger::fConsoleOut = -1;
+std::deque<std::string> Logger::fQueue;
+std::mutex Logger::fMutex;
+std::condition_variable Logger::fQueueCondition;
+std::condition_variable Logger::fFlushCondition;
+std::thread Logger::fSinkThread;
+
+const char* Logger::GetCategoryName(LogCategory category)
+{
+    switch (category) {
+        case cGENERAL:   return "general";
+        case cPROGRESS:  return "progress";
+        case cEVENT:     return "event";
+        case cHITS:      return "hits";
+        case cCANDIDATE: return "candidate";
+        case cMC:        return "mc";
+        default:         return "";
+    }
+}
+
+void Logger::SetCategories(std::string list)
+{
+    bool enableAll = (list == "all" || list == "true");
+    std::stringstream stream(list);
+    std::string name;
+
+    for (int iCategory = 0; iCategory < nCATEGORIES; iCategory++)
+        fIsEnabled[iCategory] = enableAll;
+
+    if (enableAll || list == "none" || list == "false") return;
+
+    while (std::getline(stream, name, ',')) {
+        bool isFound = false;
+        for (int iCategory = 0; iCategory < nCATEGORIES; iCategory++) {
+            if (name == GetCategoryName((LogCategory)iCategory)) {
+                fIsEnabled[iCategory] = true;
+                isFound = true;
+            }
+        }
+        if (!isFound)
+            std::cerr << "[Logger] Unknown log category: " << name << ", skipping...\n";
+    }
+}
+
+bool Logger::PassRateLimit(LogCategory category, std::string& notice)
+{
+    if (fMaxRate <= 0) return true;
+
+    // counters are shared by all threads writing to the same category
+    std::lock_guard<std::mutex> lock(fMutex);
+
+    double now = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    // start a new one-second window
+    if (now - fWindowStart[category] >= 1.) {
+        if (fNDropped[category]) {
+            notice = "[Logger] " + std::to_string(fNDropped[category]) + " message(s) in category \""
+                     + GetCategoryName(category) + "\" suppressed by rate limit\n";
+        }
+        fWindowStart[category] = now;
+        fNWritten[category] = 0;
+        fNDropped[category] = 0;
+    }
+
+    if (fNWritten[category] < fMaxRate) {
+        fNWritten[category]++;
+        return true;
+    }
+    else {
+        fNDropped[category]++;
+        return false;
+    }
+}
+
+void Logger::Write(LogCategory category, const std::string& text, bool force)
+{
+    if (!force && !fIsEnabled[category]) return;
+
+    std::string notice;
+    if (!PassRateLimit(category, notice)) return;
+
+    if (!fIsAsync) {
+        if (!notice.empty()) WriteToConsole(notice);
+        WriteToConsole(text);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(fMutex);
+    fFlushCondition.wait(lock, []{ return fQueue.size() < MAXQUEUESIZE; });
+    if (!notice.empty()) fQueue.push_back(notice);
+    fQueue.push_back(text);
+    lock.unlock();
+    fQueueCondition.notify_one();
+}
+
+void Logger::WriteToConsole(const std::string& text)
+{
+    if (fIsAsync) {
+        const char* buffer = text.data();
+        size_t nLeft = text.size();
+        while (nLeft) {
+            ssize_t nWritten = write(fConsoleOut, buffer, nLeft);
+            if (nWritten <= 0) break;
+            buffer += nWritten;
+            nLeft -= nWritten;
+        }
+    }
+    else std::cout << text;
+}
+
+void Logger::RunSink()
+{
+    std::deque<std::string> batch;
+    std::string text;
+
+    while (true) {
+        std::unique_lock<std::mutex> lock(fMutex);
+        fQueueCondition.wait(lock, []{ return fDoStop || !fQueue.empty(); });
+        if (fQueue.empty() && fDoStop) break;
+
+        batch.swap(fQueue);
+        fIsWriting = true;
+        lock.unlock();
+        fFlushCondition.notify_all();
+
+        text.clear();
+        for (auto const& message: batch) text += message;
+        WriteToConsole(text);
+        batch.clear();
+
+        lock.lock();
+        fIsWriting = false;
+        lock.unlock();
+        fFlushCondition.notify_all();
+    }
+}
+
+void Logger::Flush()
+{
+    if (fIsAsync) {
+        std::unique_lock<std::mutex> lock(fMutex);
+        fFlushCondition.wait(lock, []{ return fQueue.empty() && !fIsWriting; });
+    }
+    else std::cout.flush();
+}
+
+void Logger::StopSink()
+{
+    if (!fSinkThread.joinable()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        fDoStop = true;
+    }
+    fQueueCondition.notify_one();
+    fSinkThread.join();
+    fIsAsync = false;
+    fDoStop = false;
+}
+
+void Logger::SetAsync(bool doAsync)
+{
+    if (doAsync == fIsAsync) return;
+
+    if (doAsync) {
+        static bool isExitHandlerSet = false;
+        if (!isExitHandlerSet) {
+            std::atexit(StopSink);
+            isExitHandlerSet = true;
+        }
+
+        // console output written so far comes first
+        std::cout.flush();
+        fflush(stdout);
+        if (fConsoleOut < 0) fConsoleOut = dup(1);
+
+        fIsAsync = true;
+        fSinkThread = std::thread(RunSink);
+    }
+    else StopSink();
+}
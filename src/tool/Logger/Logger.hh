@@ -0,0 +1,118 @@
+/*******************************************
+*
+* @file Logger.hh
+*
+* @brief Defines Logger.
+*
+********************************************/
+
+#ifndef LOGGER_HH
+#define LOGGER_HH
+
+#include <string>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+/******************************************
+* @brief Log categories.
+*
+* Each category can be switched on and off
+* with the option \c -log.
+*
+* @see Logger::SetCategories
+*******************************************/
+enum LogCategory
+{
+    cGENERAL,   ///< Messages not belonging to any category below.
+    cPROGRESS,  ///< Event loop progress lines.
+    cEVENT,     ///< Per-event summary tables.
+    cHITS,      ///< Per-event hit reduction tables.
+    cCANDIDATE, ///< Per-event candidate tables.
+    cMC,        ///< Per-event MC particle and taggable tables.
+    nCATEGORIES
+};
+
+/********************************************************
+ * @brief The sink of all Printer output.
+ *
+ * @details Logger takes fully formatted text from
+ * Printer (and from table dumps) and writes it to the
+ * console. Messages are filtered by #LogCategory and
+ * optionally rate-limited per category. Callers should
+ * check Logger::IsEnabled (or Printer::IsEnabled)
+ * before formatting a table, so that a disabled
+ * category costs a single flag lookup.
+ *
+ * In asynchronous mode, messages are queued and written
+ * by a separate sink thread to a duplicate of the
+ * original stdout, so that console output does not
+ * stall event processing and is not swallowed while
+ * SK library output is suppressed. Errors are always
+ * written synchronously after the queue is flushed.
+ *******************************************************/
+class Logger
+{
+    public:
+        static bool IsEnabled(LogCategory category) { return fIsEnabled[category]; }
+
+        /**
+         * @brief Writes formatted text to the console.
+         * @param category #LogCategory of the text.
+         * @param text Text to write, including new lines.
+         * @param force If \c true, the text is written even if \c category is disabled.
+         */
+        static void Write(LogCategory category, const std::string& text, bool force=false);
+
+        /**
+         * @brief Waits until all queued messages are written.
+         */
+        static void Flush();
+
+        /**
+         * @brief Switches between synchronous and asynchronous output.
+         * @details Switching to synchronous mode flushes the queue and stops the sink thread.
+         */
+        static void SetAsync(bool doAsync);
+        static bool IsAsync() { return fIsAsync; }
+
+        /**
+         * @brief Enables the listed categories only.
+         * @param list Comma-separated list of category names,
+         * or \c all / \c none. Errors and warnings are always printed.
+         */
+        static void SetCategories(std::string list);
+
+        /**
+         * @brief Sets the maximum number of messages per second in each category.
+         * @param maxRate If 0, no rate limit is applied.
+         */
+        static void SetRateLimit(float maxRate) { fMaxRate = maxRate; }
+
+        static const char* GetCategoryName(LogCategory category);
+
+    private:
+        static bool PassRateLimit(LogCategory category, std::string& notice);
+        static void WriteToConsole(const std::string& text);
+        static void RunSink();
+        static void StopSink();
+
+        static bool fIsEnabled[nCATEGORIES];
+        static float fMaxRate;
+        static double fWindowStart[nCATEGORIES];
+        static unsigned int fNWritten[nCATEGORIES];
+        static unsigned int fNDropped[nCATEGORIES];
+
+        static bool fIsAsync;
+        static bool fDoStop;
+        static bool fIsWriting;
+        static int fConsoleOut;
+        static std::deque<std::string> fQueue;
+        static std::mutex fMutex;
+        static std::condition_variable fQueueCondition;
+        static std::condition_variable fFlushCondition;
+        static std::thread fSinkThread;
+};
+
+#endif
@@ -0,0 +1,153 @@
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "PMTHitCluster.hh"
+#include "NoiseBank.hh"
+
+static const char NOISEBANKMAGIC[8] = "NTAGNBK";
+
+NoiseBank::NoiseBank()
+: fBase(nullptr), fSize(0), fHeader(nullptr), fEntries(nullptr), fHits(nullptr), fMsg("NoiseBank") {}
+
+NoiseBank::~NoiseBank()
+{
+    Close();
+}
+
+bool NoiseBank::Open(std::string filePath)
+{
+    Close();
+
+    int fd = open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) < 0 || fileStat.st_size < (off_t)sizeof(NoiseBankHeader)) {
+        close(fd);
+        return false;
+    }
+
+    // the mapping stays valid after the descriptor is closed
+    void* base = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return false;
+
+    fBase = base;
+    fSize = fileStat.st_size;
+    fHeader = (const NoiseBankHeader*)fBase;
+
+    // validate layout before handing out pointers into the file
+    // (counts and offsets are bounded first, so that the sums below cannot overflow)
+    if (fHeader->nHits > fSize / sizeof(NoiseBankHit) || fHeader->nEntries > fSize / sizeof(NoiseBankEntry)
+        || fHeader->entryOffset > fSize) {
+        Close();
+        return false;
+    }
+    uint64_t hitsEnd = sizeof(NoiseBankHeader) + fHeader->nHits * sizeof(NoiseBankHit);
+    uint64_t entriesEnd = fHeader->entryOffset + (uint64_t)fHeader->nEntries * sizeof(NoiseBankEntry);
+    if (memcmp(fHeader->magic, NOISEBANKMAGIC, sizeof(NOISEBANKMAGIC)) || fHeader->version != VERSION
+        || fHeader->entryOffset < hitsEnd || entriesEnd > fSize) {
+        Close();
+        return false;
+    }
+
+    fHits = (const NoiseBankHit*)((const char*)fBase + sizeof(NoiseBankHeader));
+    fEntries = (const NoiseBankEntry*)((const char*)fBase + fHeader->entryOffset);
+
+    // hits of every entry must lie in the hit array
+    for (unsigned int iEntry=0; iEntry<fHeader->nEntries; iEntry++) {
+        const NoiseBankEntry& entry = fEntries[iEntry];
+        if (entry.firstHit > fHeader->nHits
+            || (uint64_t)entry.nIDHits + entry.nODHits > fHeader->nHits - entry.firstHit) {
+            fMsg.Print(Form("Entry %d of noise bank %s has hits [%lu, %lu) out of the %lu hits in the file!",
+                            iEntry, filePath.c_str(), (unsigned long)entry.firstHit,
+                            (unsigned long)(entry.firstHit + entry.nIDHits + entry.nODHits),
+                            (unsigned long)fHeader->nHits), pERROR);
+        }
+    }
+
+    return true;
+}
+
+void NoiseBank::Close()
+{
+    if (fBase) munmap(fBase, fSize);
+    fBase = nullptr; fSize = 0;
+    fHeader = nullptr; fEntries = nullptr; fHits = nullptr;
+}
+
+NoiseBankWriter::NoiseBankWriter()
+: fFile(nullptr), fNHits(0), fIsGood(false) {}
+
+NoiseBankWriter::~NoiseBankWriter()
+{
+    if (fFile) Close();
+}
+
+bool NoiseBankWriter::Open(std::string filePath)
+{
+    fFile = fopen(filePath.c_str(), "wb");
+    fNHits = 0;
+    fEntries.clear();
+
+    // header is rewritten at Close
+    NoiseBankHeader header = {};
+    fIsGood = fFile && fwrite(&header, sizeof(header), 1, fFile) == 1;
+
+    return fIsGood;
+}
+
+void NoiseBankWriter::AddEntry(NoiseBankEntry entry, const PMTHitCluster& idHits, const PMTHitCluster& odHits)
+{
+    entry.firstHit = fNHits;
+    entry.nIDHits = idHits.GetSize();
+    entry.nODHits = odHits.GetSize();
+    entry.padding = 0;
+
+    WriteHits(idHits);
+    WriteHits(odHits);
+    fEntries.push_back(entry);
+}
+
+void NoiseBankWriter::WriteHits(const PMTHitCluster& hits)
+{
+    fHitBuffer.clear();
+    for (auto const& hit: hits)
+        fHitBuffer.push_back({(float)hit.t(), hit.q(), (int32_t)hit.i()});
+
+    if (!fHitBuffer.empty())
+        fIsGood &= fwrite(fHitBuffer.data(), sizeof(NoiseBankHit), fHitBuffer.size(), fFile) == fHitBuffer.size();
+    fNHits += fHitBuffer.size();
+}
+
+bool NoiseBankWriter::Close()
+{
+    if (!fFile) return false;
+
+    // align the entry table to 8 bytes
+    uint64_t entryOffset = sizeof(NoiseBankHeader) + fNHits * sizeof(NoiseBankHit);
+    char zeros[8] = {};
+    unsigned int nPadding = (8 - entryOffset % 8) % 8;
+    if (nPadding) fIsGood &= fwrite(zeros, 1, nPadding, fFile) == nPadding;
+    entryOffset += nPadding;
+
+    if (!fEntries.empty())
+        fIsGood &= fwrite(fEntries.data(), sizeof(NoiseBankEntry), fEntries.size(), fFile) == fEntries.size();
+
+    NoiseBankHeader header = {};
+    memcpy(header.magic, NOISEBANKMAGIC, sizeof(NOISEBANKMAGIC));
+    header.version = NoiseBank::VERSION;
+    header.nEntries = fEntries.size();
+    header.nHits = fNHits;
+    header.entryOffset = entryOffset;
+    fIsGood &= fseek(fFile, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, fFile) == 1;
+
+    fIsGood &= fclose(fFile) == 0;
+    fFile = nullptr;
+
+    return fIsGood;
+}
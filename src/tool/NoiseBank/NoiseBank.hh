@@ -0,0 +1,144 @@
+/*******************************************
+*
+* @file NoiseBank.hh
+*
+* @brief Defines NoiseBank and NoiseBankWriter.
+*
+********************************************/
+
+#ifndef NOISEBANK_HH
+#define NOISEBANK_HH
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Printer.hh"
+
+class PMTHitCluster;
+
+/******************************************
+* @brief File header of a noise bank.
+*******************************************/
+struct NoiseBankHeader
+{
+    char     magic[8];    ///< "NTAGNBK" + null
+    uint32_t version;
+    uint32_t nEntries;
+    uint64_t nHits;       ///< Total number of ID and OD hits
+    uint64_t entryOffset; ///< Byte offset of the entry table
+};
+
+/******************************************
+* @brief One dummy trigger event in a noise bank.
+*
+* @details Hits of an entry are stored
+* contiguously: \c nIDHits ID hits followed by
+* \c nODHits OD hits, each time-sorted.
+*******************************************/
+struct NoiseBankEntry
+{
+    int32_t  run, subrun, event, trigger;
+    uint64_t firstHit;           ///< Index of the first ID hit in the hit array
+    uint32_t nIDHits, nODHits;
+    float    minT, maxT;         ///< Time range covered by both ID and OD hits (ns)
+    uint16_t idMaxN200, odMaxN200; ///< Maximum number of hits in 200 ns bins
+    uint32_t padding;
+};
+
+/******************************************
+* @brief One PMT hit in a noise bank.
+*******************************************/
+struct NoiseBankHit
+{
+    float   t, q;
+    int32_t i;
+};
+
+/********************************************************
+ * @brief Read-only view of a memory-mapped noise bank.
+ *
+ * @details A noise bank is a flat binary file of
+ * dummy trigger hits made by NoiseBankWriter: the hits
+ * are already selected by trigger type, time-sorted
+ * and shifted to the noise tree time frame, and each
+ * entry carries its time range and maximum N200.
+ * The file is mapped read-only and shared, so that all
+ * NTag/AddNoise processes on a node reading the same
+ * bank share one copy in the page cache, and reading
+ * noise needs no ROOT I/O.
+ *******************************************************/
+class NoiseBank
+{
+    public:
+        NoiseBank();
+        ~NoiseBank();
+
+        /**
+         * @brief Maps the bank file at \c filePath.
+         * @return \c false if the file cannot be mapped or is not a valid noise bank.
+         * Exits if the hits of any entry are out of the hit array of the file.
+         */
+        bool Open(std::string filePath);
+        void Close();
+        bool IsOpen() const { return fBase != nullptr; }
+
+        unsigned int GetNEntries() const { return fHeader->nEntries; }
+        const NoiseBankEntry& GetEntry(unsigned int iEntry) const { return fEntries[iEntry]; }
+        const NoiseBankHit* GetIDHits(const NoiseBankEntry& entry) const { return fHits + entry.firstHit; }
+        const NoiseBankHit* GetODHits(const NoiseBankEntry& entry) const { return fHits + entry.firstHit + entry.nIDHits; }
+
+        static const uint32_t VERSION = 1;
+
+    private:
+        void*  fBase;
+        size_t fSize;
+        const NoiseBankHeader* fHeader;
+        const NoiseBankEntry*  fEntries;
+        const NoiseBankHit*    fHits;
+
+        Printer fMsg;
+};
+
+/********************************************************
+ * @brief Writes a noise bank entry by entry.
+ *
+ * @details Hits are written as entries are added and
+ * the entry table is written at NoiseBankWriter::Close.
+ *******************************************************/
+class NoiseBankWriter
+{
+    public:
+        NoiseBankWriter();
+        ~NoiseBankWriter();
+
+        bool Open(std::string filePath);
+
+        /**
+         * @brief Appends an entry.
+         * @param entry Entry information. Hit offsets and counts are filled here.
+         * @param idHits Time-sorted ID hits.
+         * @param odHits Time-sorted OD hits.
+         */
+        void AddEntry(NoiseBankEntry entry, const PMTHitCluster& idHits, const PMTHitCluster& odHits);
+
+        /**
+         * @brief Writes the entry table and header, and closes the file.
+         * @return \c false if any write failed.
+         */
+        bool Close();
+
+        unsigned int GetNEntries() const { return fEntries.size(); }
+
+    private:
+        void WriteHits(const PMTHitCluster& hits);
+
+        FILE* fFile;
+        uint64_t fNHits;
+        bool fIsGood;
+        std::vector<NoiseBankEntry> fEntries;
+        std::vector<NoiseBankHit> fHitBuffer;
+};
+
+#endif
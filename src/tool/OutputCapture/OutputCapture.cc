@@ -0,0 +1,141 @@
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "OutputCapture.hh"
+
+int  OutputCapture::fStdOut     = -1;
+int  OutputCapture::fNullOut    = -1;
+int  OutputCapture::fCaptureOut = -1;
+int  OutputCapture::fDepth      = 0;
+bool OutputCapture::fIsOpen     = false;
+
+std::vector<char> OutputCapture::fRing;
+unsigned int OutputCapture::fRingHead = 0;
+bool OutputCapture::fIsRingFull = false;
+std::thread::id OutputCapture::fRingOwner;
+
+void OutputCapture::OpenDescriptors()
+{
+    fflush(stdout);
+    fStdOut  = dup(1);
+    fNullOut = open("/dev/null", O_WRONLY);
+
+    // unlinked temporary file: removed from disk as soon as the process exits
+    char capturePath[] = "/tmp/ntag_capture_XXXXXX";
+    fCaptureOut = mkstemp(capturePath);
+    if (fCaptureOut >= 0) unlink(capturePath);
+
+    fIsOpen = true;
+}
+
+void OutputCapture::Suppress()
+{
+    if (!fIsOpen) OpenDescriptors();
+
+    if (fDepth++ == 0) {
+        fflush(stdout);
+        bool doCapture = !fRing.empty() && fCaptureOut >= 0;
+        dup2(doCapture ? fCaptureOut : fNullOut, 1);
+    }
+}
+
+void OutputCapture::Restore()
+{
+    if (fDepth == 0) return;
+
+    if (--fDepth == 0) {
+        fflush(stdout);
+        dup2(fStdOut, 1);
+        if (!fRing.empty()) DrainCaptureFile();
+    }
+}
+
+void OutputCapture::SetRingSize(unsigned int nBytes)
+{
+    fRing.assign(nBytes, '\0');
+    fRingHead = 0;
+    fIsRingFull = false;
+    fRingOwner = std::this_thread::get_id();
+}
+
+bool OutputCapture::HasRingOutput()
+{
+    // Suppress/Restore run on the owner thread: the ring is not locked
+    return (fRingHead || fIsRingFull) && fDepth == 0 && std::this_thread::get_id() == fRingOwner;
+}
+
+void OutputCapture::DrainCaptureFile()
+{
+    if (fCaptureOut < 0) return;
+
+    // fd 1 shared the file offset with fCaptureOut while redirected
+    off_t nWritten = lseek(fCaptureOut, 0, SEEK_CUR);
+    if (nWritten <= 0) return;
+
+    char buffer[4096];
+    off_t offset = 0;
+
+    // only the last fRing.size() bytes can survive in the ring
+    if (nWritten > (off_t)fRing.size())
+        offset = nWritten - fRing.size();
+
+    while (offset < nWritten) {
+        ssize_t nRead = pread(fCaptureOut, buffer, sizeof(buffer), offset);
+        if (nRead <= 0) break;
+        PushToRing(buffer, nRead);
+        offset += nRead;
+    }
+
+    if (ftruncate(fCaptureOut, 0) == 0)
+        lseek(fCaptureOut, 0, SEEK_SET);
+}
+
+void OutputCapture::PushToRing(const char* buffer, unsigned int nBytes)
+{
+    unsigned int ringSize = fRing.size();
+    if (!ringSize) return;
+
+    if (nBytes >= ringSize) {
+        buffer += nBytes - ringSize;
+        nBytes = ringSize;
+    }
+
+    unsigned int nTail = std::min(nBytes, ringSize - fRingHead);
+    memcpy(&fRing[fRingHead], buffer, nTail);
+    memcpy(&fRing[0], buffer + nTail, nBytes - nTail);
+
+    if (fRingHead + nBytes >= ringSize) fIsRingFull = true;
+    fRingHead = (fRingHead + nBytes) % ringSize;
+}
+
+void OutputCapture::DumpRing()
+{
+    if (fRing.empty()) return;
+
+    // pick up output of a library call that was interrupted before Restore
+    if (fDepth > 0) {
+        fflush(stdout);
+        DrainCaptureFile();
+    }
+
+    unsigned int start = fIsRingFull ? fRingHead : 0;
+    unsigned int nBytes = fIsRingFull ? fRing.size() : fRingHead;
+    if (!nBytes) return;
+
+    const char* header = "\n---------- Captured library output (latest) ----------\n";
+    const char* footer = "\n-------------------------------------------------------\n";
+
+    ssize_t status = write(2, header, strlen(header));
+    unsigned int nTail = std::min(nBytes, (unsigned int)fRing.size() - start);
+    status = write(2, &fRing[start], nTail);
+    if (nBytes > nTail) status = write(2, &fRing[0], nBytes - nTail);
+    status = write(2, footer, strlen(footer));
+    (void)status;
+
+    fRingHead = 0;
+    fIsRingFull = false;
+}
@@ -0,0 +1,88 @@
+/*******************************************
+*
+* @file OutputCapture.hh
+*
+* @brief Defines OutputCapture.
+*
+********************************************/
+
+#ifndef OUTPUTCAPTURE_HH
+#define OUTPUTCAPTURE_HH
+
+#include <thread>
+#include <vector>
+
+/********************************************************
+ * @brief Process-wide stdout capture for noisy
+ * Fortran/C library calls.
+ *
+ * @details The file descriptors needed for redirection
+ * (a backup of stdout, \c /dev/null and an unlinked
+ * capture file) are opened once at the first use and
+ * kept open for the whole job, so that switching
+ * stdout on and off costs a single \c dup2 each.
+ *
+ * If a nonzero ring size is set with
+ * OutputCapture::SetRingSize, the suppressed output is
+ * written to the capture file instead of \c /dev/null,
+ * and is moved into a bounded in-memory ring buffer
+ * when stdout is restored. The ring keeps only the
+ * latest output and is dumped to stderr by
+ * OutputCapture::DumpRing, which Printer calls before
+ * exiting on an error, and before each debug message
+ * printed on the thread that set the ring size.
+ *
+ * Suppress/Restore calls may be nested; only the
+ * outermost pair switches the file descriptor.
+ *******************************************************/
+class OutputCapture
+{
+    public:
+        /**
+         * @brief Redirects stdout to \c /dev/null or to the capture file.
+         */
+        static void Suppress();
+
+        /**
+         * @brief Restores stdout and moves captured output (if any) to the ring.
+         */
+        static void Restore();
+
+        /**
+         * @brief Sets the size of the in-memory ring buffer.
+         * @param nBytes Ring size in bytes. If 0, suppressed output is discarded.
+         */
+        static void SetRingSize(unsigned int nBytes);
+        static unsigned int GetRingSize() { return fRing.size(); }
+
+        /**
+         * @brief Returns \c true if the ring holds output to dump, stdout is not
+         * suppressed, and the caller is the thread that set the ring size.
+         */
+        static bool HasRingOutput();
+
+        /**
+         * @brief Writes the ring buffer content to stderr (oldest first) and clears it.
+         */
+        static void DumpRing();
+
+        static bool IsSuppressed() { return fDepth > 0; }
+
+    private:
+        static void OpenDescriptors();
+        static void DrainCaptureFile();
+        static void PushToRing(const char* buffer, unsigned int nBytes);
+
+        static int fStdOut;
+        static int fNullOut;
+        static int fCaptureOut;
+        static int fDepth;
+        static bool fIsOpen;
+
+        static std::vector<char> fRing;
+        static unsigned int fRingHead;
+        static bool fIsRingFull;
+        static std::thread::id fRingOwner;
+};
+
+#endif
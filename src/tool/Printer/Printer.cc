@@ -1,64 +1,77 @@
 #include <iostream>
 #include <iomanip>
+#include <sstream>
 
+#include "OutputCapture.hh"
 #include "Printer.hh"
 
-Printer::Printer(std::string className, Verbosity verbose):
-fClassName(className), fVerbosity(verbose) {}
+Printer::Printer(std::string className, Verbosity verbose, LogCategory category):
+fClassName(className), fVerbosity(verbose), fCategory(category) {}
 Printer::~Printer() {}
 
-void Printer::PrintTag(Verbosity vType)
+std::string Printer::GetTag(Verbosity vType)
 {
     switch (vType) {
-        case pNONE:
-            break;
         case pERROR:
-            std::cerr << "\033[4;31m" << "[Error in " << fClassName << "]"; break;
+            return "\033[4;31m[Error in " + fClassName + "]";
         case pWARNING:
-            std::cout << "\033[4;33m" << "[" << fClassName << " WARNING] "; break;
+            return "\033[4;33m[" + fClassName + " WARNING] ";
         case pDEFAULT:
-            std::cout << "[" << fClassName << "] "; break;
+            return "[" + fClassName + "] ";
         case pDEBUG:
-            std::cout << "\033[0;34m" << "[" << fClassName << " DEBUG] "; break;
+            return "\033[0;34m[" + fClassName + " DEBUG] ";
+        default:
+            return "";
     }
 }
 
 void Printer::Print(TString msg, Verbosity vType, bool newLine)
 {
     if (vType <= fVerbosity) {
-        PrintTag(vType);
         if (vType == pERROR) {
-            std::cerr << "\033[m " << msg;
+            Logger::Flush();
+            std::cerr << GetTag(vType) << "\033[m " << msg;
+            OutputCapture::DumpRing();
             exit(1);
         }
-        else {
-            std::cout << "\033[m" << msg;
-            if (newLine) std::cout << "\n";
+        else if (vType == pWARNING || Logger::IsEnabled(fCategory)) {
+            // library output suppressed since the last debug message comes first
+            if (vType == pDEBUG && OutputCapture::HasRingOutput()) {
+                Logger::Flush();
+                OutputCapture::DumpRing();
+            }
+            std::string line = GetTag(vType) + "\033[m" + msg.Data();
+            if (newLine) line += "\n";
+            Logger::Write(fCategory, line, vType == pWARNING);
         }
     }
 }
 
 void Printer::PrintBlock(TString line, BlockSize size, Verbosity vType, bool newLine)
 {
+    if (!IsEnabled(vType)) return;
+
     std::string blockWall(size, '=');
     TString coloredLine = "\033[1;36m" + line + "\033[m";
+    std::string tag = GetTag(vType) + "\033[m";
 
-    std::cout << "\n";
-    Print(blockWall, vType);
-    if (size == pMAIN) {
-        Print("", vType, false);
-        std::cout << std::right << std::setw((size + coloredLine.Length())/2) << coloredLine << "\n";
-    }
+    std::ostringstream block;
+    block << "\n";
+    block << tag << blockWall << "\n";
+    if (size == pMAIN)
+        block << tag << std::right << std::setw((size + coloredLine.Length())/2) << coloredLine << "\n";
     else
-        Print(coloredLine, vType);
-    Print(blockWall, vType);
+        block << tag << coloredLine << "\n";
+    block << tag << blockWall << "\n";
+    if (newLine) block << "\n";
 
-    if (newLine) std::cout << "\n";
+    Logger::Write(fCategory, block.str());
 }
 
 void Printer::PrintTitle(TString line)
 {
-    std::cout << "\n\n********** " << line << " **********\n";
+    if (!Logger::IsEnabled(fCategory)) return;
+    Logger::Write(fCategory, std::string("\n\n********** ") + line.Data() + " **********\n");
 }
 
 float Printer::Timer(TString msg, std::clock_t tStart, Verbosity vType)
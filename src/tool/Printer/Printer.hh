@@ -5,11 +5,13 @@
 
 #include <TString.h>
 
+#include "Logger.hh"
+
 /******************************************
 *
 * @brief Verbosity flags
 *
-* @see Printer::PrintTag
+* @see Printer::GetTag
 * @see Printer::Print
 *
 *******************************************/
@@ -52,6 +54,9 @@ enum BlockSize
  *
  * Timer function is also provided by Printer::Timer.
  *
+ * All output except errors goes through Logger,
+ * under the #LogCategory given to the constructor.
+ *
  * @see #Verbosity
  *******************************************************/
 class Printer
@@ -62,14 +67,15 @@ class Printer
          * @details Sample message with \c className "TempClass": [NTagTempClass] Sample message.
          * @param className The class name to print in all messages. Use the name of the owner class.
          * @param verbose #Verbosity.
+         * @param category #LogCategory of the messages.
          */
-        Printer(std::string className="", Verbosity verbose=pDEFAULT);
+        Printer(std::string className="", Verbosity verbose=pDEFAULT, LogCategory category=cGENERAL);
         ~Printer();
 
         /**
-         * @brief Prints colored (red for errors and yellow for warnings) tags.
+         * @brief Returns colored (red for errors and yellow for warnings) tags.
          */
-        virtual void  PrintTag(Verbosity);
+        virtual std::string GetTag(Verbosity);
 
         /**
          * @brief Prints one-liners.
@@ -101,10 +107,19 @@ class Printer
         virtual float Timer(TString line, std::clock_t tStart, Verbosity vType=pDEFAULT);
 
         inline void SetVerbosity(Verbosity verbose) { fVerbosity = verbose; }
+        inline Verbosity GetVerbosity() const { return fVerbosity; }
+
+        /**
+         * @brief Returns \c true if a message of type \c vType would be printed.
+         * @details Use this to skip formatting of tables and messages that would be discarded.
+         */
+        inline bool IsEnabled(Verbosity vType=pDEFAULT) const
+        { return vType <= fVerbosity && Logger::IsEnabled(fCategory); }
 
     private:
         std::string  fClassName;
         Verbosity    fVerbosity;
+        LogCategory  fCategory;
 };
 
 #endif
\ No newline at end of file
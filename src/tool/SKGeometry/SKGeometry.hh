@@ -0,0 +1,116 @@
+/*******************************************
+*
+* @file SKGeometry.hh
+*
+* @brief Defines inline functions of the SK inner tank geometry.
+*
+********************************************/
+
+#ifndef SKGEOMETRY_HH
+#define SKGEOMETRY_HH
+
+#include <algorithm>
+#include <cmath>
+
+#include <geotnkC.h>
+
+/********************************************************
+ * @brief Distances from points to the SK inner tank wall.
+ *
+ * @details The inner tank is the cylinder of radius
+ * \c RINTK and height from \c ZMINTK to \c ZPINTK
+ * in \c geotnkC.h. All coordinates are SK x, y, z in cm.
+ *
+ * SKGeometry::GetDWall gives the same result as the
+ * Fortran \c wallsk without a call to Fortran, so that
+ * it can be inlined in loops over many points.
+ * The functions taking arrays apply the same function
+ * to each point. main/SKGeometryCheck.cc compares them
+ * with \c wallsk over a grid of points.
+ *******************************************************/
+namespace SKGeometry
+{
+    /**
+     * @brief Nearest distance to the inner tank wall (negative outside the tank).
+     */
+    inline float GetDWall(float x, float y, float z)
+    {
+        float r = std::sqrt(x*x + y*y);
+        return std::min(std::min(ZPINTK - z, z - ZMINTK), RINTK - r);
+    }
+
+    /**
+     * @brief Distance to the inner tank wall along the unit vector (\c dx, \c dy, \c dz).
+     */
+    inline float GetDWallInDirection(float x, float y, float z, float dx, float dy, float dz)
+    {
+        float dot = x*dx + y*dy;
+        float dirSq = dx*dx + dy*dy; float vtxSq = x*x + y*y;
+
+        // distance to barrel and distance to top/bottom
+        float distR = std::fabs((-dot + std::sqrt(dot*dot + dirSq*(RINTK*RINTK - vtxSq))) / dirSq);
+        float distZ = std::fabs(dz > 0 ? (ZPINTK-z)/dz : (ZMINTK-z)/dz);
+
+        // the smaller
+        if (std::isnan(distZ)) return distR;
+        else return distR < distZ ? distR : distZ;
+    }
+
+    /**
+     * @brief Distance to the inner tank wall backwards along the unit vector (\c dx, \c dy, \c dz).
+     * @details Effective wall distance of an event at the point going in the direction.
+     */
+    inline float GetEffectiveWall(float x, float y, float z, float dx, float dy, float dz)
+    {
+        return GetDWallInDirection(x, y, z, -dx, -dy, -dz);
+    }
+
+    /**
+     * @brief Returns \c true if the point is more than \c fvCut away from the inner tank wall.
+     * @param fvCut Distance from the wall to the fiducial volume boundary (cm).
+     */
+    inline bool IsInFiducialVolume(float x, float y, float z, float fvCut=200)
+    {
+        return GetDWall(x, y, z) > fvCut;
+    }
+
+    /**
+     * @brief SKGeometry::GetDWall of \c n points.
+     */
+    inline void GetDWall(const float* x, const float* y, const float* z, float* dWall, unsigned int n)
+    {
+        for (unsigned int i=0; i<n; i++)
+            dWall[i] = GetDWall(x[i], y[i], z[i]);
+    }
+
+    /**
+     * @brief SKGeometry::GetDWallInDirection of \c n points, each with a unit vector.
+     */
+    inline void GetDWallInDirection(const float* x, const float* y, const float* z,
+                                    const float* dx, const float* dy, const float* dz, float* dWall, unsigned int n)
+    {
+        for (unsigned int i=0; i<n; i++)
+            dWall[i] = GetDWallInDirection(x[i], y[i], z[i], dx[i], dy[i], dz[i]);
+    }
+
+    /**
+     * @brief SKGeometry::GetEffectiveWall of \c n points, each with a unit vector.
+     */
+    inline void GetEffectiveWall(const float* x, const float* y, const float* z,
+                                 const float* dx, const float* dy, const float* dz, float* effWall, unsigned int n)
+    {
+        for (unsigned int i=0; i<n; i++)
+            effWall[i] = GetEffectiveWall(x[i], y[i], z[i], dx[i], dy[i], dz[i]);
+    }
+
+    /**
+     * @brief SKGeometry::IsInFiducialVolume of \c n points.
+     */
+    inline void IsInFiducialVolume(const float* x, const float* y, const float* z, bool* isInFV, unsigned int n, float fvCut=200)
+    {
+        for (unsigned int i=0; i<n; i++)
+            isInFV[i] = IsInFiducialVolume(x[i], y[i], z[i], fvCut);
+    }
+}
+
+#endif
@@ -1,3 +1,7 @@
+#include <map>
+#include <tuple>
+#include <cstring>
+
 #include <skheadC.h>
 #undef MAXHWSK
 #include <fortran_interface.h>
@@ -10,6 +14,7 @@
 #include "nbnkC.h"
 
 #include "SKLibs.hh"
+#include "OutputCapture.hh"
 #include "SKIO.hh"
 
 bool SKIO::fIsZEBRAInitialized = false;
@@ -21,9 +26,30 @@ int SKIO::fSKGeometry = 5;
 int SKIO::fSKBadChOption = 0;
 int SKIO::fRefRunNo = 85619;
 
-int SKIO::fTmpOut = 0;
-int SKIO::fBackupOut = 0;
 bool SKIO::fVerbose = false;
+int SKIO::fDarkRateVersion = 0;
+int SKIO::fBadChRunNo = 0;
+int SKIO::fBadChSubrunNo = 0;
+
+// Snapshot of the common blocks filled by skbadch_ and skdark_
+struct BadChannelTables
+{
+    bool isValid;
+    int  darkRateVersion;
+    combad_common   badID;
+    combada_common  badOD;
+    combad00_common badID0;
+    comdark_common  dark;
+};
+
+// source of SKIO::fDarkRateVersion, bumped on every change of the tables
+static int gNDarkRateChanges = 0;
+
+// (run, subrun, SKBADOPT) -> tables
+static std::map<std::tuple<int, int, int>, BadChannelTables> gBadChannelCache;
+// (requested run, SKBADOPT) -> closest run with a valid bad channel list
+static std::map<std::pair<int, int>, int> gNearestBadChannelRun;
+static const unsigned int MAXCACHEDTABLES = 50;
 
 SKIO::SKIO()
 : fIOMode(mInput), fFileFormat(mZBS), fFilePath(""),
@@ -302,6 +328,29 @@ void SKIO::SetRefRunNo(int refRunNo)
 
 int SKIO::SetBadChannels(int runNo, int subrunNo, bool fetchTQ)
 {
+    auto key = std::make_tuple(runNo, subrunNo, fSKBadChOption);
+    auto cached = gBadChannelCache.find(key);
+
+    // restore tables from the previous call with the same key
+    if (cached != gBadChannelCache.end()) {
+        auto const& tables = cached->second;
+        if (tables.isValid) {
+            memcpy(&combad_,   &tables.badID,  sizeof(combad_common));
+            memcpy(&combada_,  &tables.badOD,  sizeof(combada_common));
+            memcpy(&combad00_, &tables.badID0, sizeof(combad00_common));
+            memcpy(&comdark_,  &tables.dark,   sizeof(comdark_common));
+            fDarkRateVersion = tables.darkRateVersion;
+            fBadChRunNo = runNo; fBadChSubrunNo = subrunNo;
+        }
+        if (fetchTQ) {
+            SKIO::DisableConsoleOut();
+            skbadch_mask_tqz_();
+            tqrealsk_();
+            SKIO::EnableConsoleOut();
+        }
+        return tables.isValid;
+    }
+
     int badchError = 0; int darkError = 0;
     combad_.log_level_skbadch = 4; // silent
     comdark_.log_level_skdark = 4; // silent
@@ -313,7 +362,54 @@ int SKIO::SetBadChannels(int runNo, int subrunNo, bool fetchTQ)
         tqrealsk_();
     }
     SKIO::EnableConsoleOut();
-    return (badchError>=0) && (darkError==0);
+
+    // comdark_ may have been modified, even if the read failed
+    fDarkRateVersion = ++gNDarkRateChanges;
+
+    if (gBadChannelCache.size() >= MAXCACHEDTABLES)
+        gBadChannelCache.clear();
+
+    auto& tables = gBadChannelCache[key];
+    tables.isValid = (badchError>=0) && (darkError==0);
+    tables.darkRateVersion = fDarkRateVersion;
+    if (tables.isValid) {
+        memcpy(&tables.badID,  &combad_,   sizeof(combad_common));
+        memcpy(&tables.badOD,  &combada_,  sizeof(combada_common));
+        memcpy(&tables.badID0, &combad00_, sizeof(combad00_common));
+        memcpy(&tables.dark,   &comdark_,  sizeof(comdark_common));
+        fBadChRunNo = runNo; fBadChSubrunNo = subrunNo;
+    }
+
+    return tables.isValid;
+}
+
+int SKIO::FindNearestBadChannelRun(int runNo, int maxStep)
+{
+    auto key = std::make_pair(runNo, fSKBadChOption);
+    auto cached = gNearestBadChannelRun.find(key);
+    if (cached != gNearestBadChannelRun.end())
+        return cached->second;
+
+    // probe runNo, runNo-1, runNo+1, runNo-2, runNo+2, ...
+    int nearestRunNo = runNo;
+    int readStatus = SKIO::SetBadChannels(nearestRunNo, 0);
+    int step = 1; int sign = 1;
+    while (!readStatus && step<maxStep) {
+        nearestRunNo -= sign*step;
+        readStatus = SKIO::SetBadChannels(nearestRunNo, 0);
+        sign *= -1; step += 1;
+    }
+
+    if (!readStatus) nearestRunNo = 0;
+    gNearestBadChannelRun[key] = nearestRunNo;
+
+    // failed probes are not needed once the result is cached
+    for (auto it = gBadChannelCache.begin(); it != gBadChannelCache.end();) {
+        if (!it->second.isValid) it = gBadChannelCache.erase(it);
+        else ++it;
+    }
+
+    return nearestRunNo;
 }
 
 void SKIO::ResetBadChannels()
@@ -333,6 +429,11 @@ void SKIO::ResetBadChannels()
         combada_.ibada[iPMT] = 0;
         combada_.isqbada[iPMT] = 0;
     }
+
+    fBadChRunNo = 0; fBadChSubrunNo = 0;
+
+    // tables derived from these no longer match any SetBadChannels call
+    fDarkRateVersion = ++gNDarkRateChanges;
 }
 
 //int SKIO::FindSKGeometry()
@@ -356,14 +457,15 @@ void SKIO::ResetBadChannels()
 
 void SKIO::ClearTQCommon()
 {
+    sktqz_.nqiskz = 0;
+    rawtqinfo_.nqisk_raw = 0;
+
     for (int iHit=0; iHit<30*MAXPM; iHit++) {
-        sktqz_.nqiskz = 0;
         sktqz_.tiskz[iHit] = 0;
         sktqz_.qiskz[iHit] = 0;
         sktqz_.icabiz[iHit] = 0;
         sktqz_.ihtiflz[iHit] = 0;
 
-        rawtqinfo_.nqisk_raw = 0;
         rawtqinfo_.tbuf_raw[iHit] = 0;
         rawtqinfo_.qbuf_raw[iHit] = 0;
         rawtqinfo_.icabbf_raw[iHit] = 0;
@@ -419,22 +521,12 @@ float SKIO::GetMCTriggerOffset(FileFormat format)
 
 void SKIO::DisableConsoleOut()
 {
-    if (!fVerbose) {
-        fflush(stdout);
-        fBackupOut = dup(1);
-        FILE* f = fopen("/dev/null", "w");
-        fTmpOut = fileno(f);
-        dup2(fTmpOut, 1);
-        fclose(f);
-    }
+    if (!fVerbose)
+        OutputCapture::Suppress();
 }
 
 void SKIO::EnableConsoleOut()
 {
     if (!fVerbose)
-    {
-        fflush(stdout);
-        dup2(fBackupOut, 1);
-        close(fBackupOut);
-    }
-}
\ No newline at end of file
+        OutputCapture::Restore();
+}
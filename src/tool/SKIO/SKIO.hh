@@ -89,7 +89,15 @@ class SKIO
         static int GetRefRunNo() { return fRefRunNo; }
         static void SetRefRunNo(int refRunNo);
 
+        // bad channel and dark rate tables are cached per (run, subrun, SKBADOPT)
         static int SetBadChannels(int runNo, int subrunNo=1, bool fetchTQ=false);
+        // returns 0 if no run within maxStep from runNo has a bad channel list
+        static int FindNearestBadChannelRun(int runNo, int maxStep=100);
+        // changes whenever SetBadChannels changes the dark rates in comdark_, and on ResetBadChannels
+        static int GetDarkRateVersion() { return fDarkRateVersion; }
+        // run and subrun of the tables last set by SetBadChannels (0 if reset)
+        static int GetBadChRunNo() { return fBadChRunNo; }
+        static int GetBadChSubrunNo() { return fBadChSubrunNo; }
         static void ResetBadChannels();
 
         static void ClearTQCommon();
@@ -121,9 +129,9 @@ class SKIO
         static int fSKBadChOption;
         static int fRefRunNo;
 
-        static int fTmpOut;
-        static int fBackupOut;
         static bool fVerbose;
+        static int fDarkRateVersion;
+        static int fBadChRunNo, fBadChSubrunNo;
 
         Printer fMsg;
 };
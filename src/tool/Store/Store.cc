@@ -1,4 +1,5 @@
 #include <iomanip>
+#include <sstream>
 #include <ios>
 #include <algorithm>
 
@@ -51,7 +52,8 @@ void Store::ReadArguments(const ArgParser& argParser)
 
 void Store::Print() const
 {
-    Printer msg;
+    Printer msg(name);
+    if (!msg.IsEnabled()) return;
     msg.PrintBlock(name + ": Keys and values");
 
     unsigned int maxWidth = 0;
@@ -60,9 +62,12 @@ void Store::Print() const
             maxWidth = key.length();
     }
 
-    for (auto const& key: fKeyOrder)
-        std::cout << std::left << std::setw(maxWidth+1) << key << ": " << fMap.at(key).second << "\n";
-    std::cout << std::endl;
+    for (auto const& key: fKeyOrder) {
+        std::ostringstream line;
+        line << std::left << std::setw(maxWidth+1) << key << ": " << fMap.at(key).second;
+        if (&key == &fKeyOrder.back()) line << "\n";
+        msg.Print(line.str());
+    }
 }
 
 void Store::MakeBranches()
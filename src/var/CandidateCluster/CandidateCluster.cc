@@ -1,5 +1,6 @@
 #include <algorithm>
 #include <iomanip>
+#include <sstream>
 #include <cassert>
 #include <cmath>
 
@@ -28,14 +29,17 @@ CandidateCluster::~CandidateCluster()
 
 void CandidateCluster::DumpAllElements(std::vector<std::string> keys, bool showTaggedOnly) const
 {
-    Printer msg;
+    Printer msg("", pDEFAULT, cCANDIDATE);
+    if (!msg.IsEnabled()) return;
+
     msg.PrintBlock(fName + (showTaggedOnly?" Tagged":"") + " Candidates", pSUBEVENT);
+    std::ostringstream table;
 
     if (!GetSize()) {
         msg.Print("No candidate in cluster!");
     }
     else {
-        std::cout << "\033[4m No. ";
+        table << "\033[4m No. ";
         auto baseFeatureMap = fElement.at(0).GetFeatureMap();
 
         if (keys.empty()) {
@@ -45,57 +49,59 @@ void CandidateCluster::DumpAllElements(std::vector<std::string> keys, bool showT
 
         for (auto const& key: keys) {
             int textWidth = key.size()>6 ? key.size() : 6;
-            std::cout << std::right << std::setw(textWidth) << key << " ";
+            table << std::right << std::setw(textWidth) << key << " ";
         }
-        std::cout << "\033[0m\n";
+        table << "\033[0m\n";
 
         for (unsigned int iCandidate = 0; iCandidate < GetSize(); iCandidate++) {
 
             if (showTaggedOnly && fElement.at(iCandidate).Get("TagClass")==0) continue;
 
-            std::cout << std::right << std::setw(4) << iCandidate+1 << " ";
+            table << std::right << std::setw(4) << iCandidate+1 << " ";
             auto candidateFeatureMap = fElement.at(iCandidate).GetFeatureMap();
             for (auto const& key: keys) {
                 int textWidth = key.size()>6 ? key.size() : 6;
                 float value = fElement.at(iCandidate)[key];
                 auto keyString = TString(key);
                 if (keyString.Contains("Index")) {
-                    std::cout << std::right << std::setw(textWidth) << (value>=0 ? std::to_string(int(value+1)) : "-") << " ";
+                    table << std::right << std::setw(textWidth) << (value>=0 ? std::to_string(int(value+1)) : "-") << " ";
                 }
                 else if (keyString.Contains("FitT") && fabs(value) < 10) {
-                    std::cout << std::fixed << std::setprecision(2) << std::setw(textWidth) << value << " ";
+                    table << std::fixed << std::setprecision(2) << std::setw(textWidth) << value << " ";
                 }
                 else if (keyString.Contains("BSenergy")) {
-                    std::cout << std::setw(textWidth) << (value>=0 ? Form("%3.2f",value) : "-");
+                    table << std::setw(textWidth) << (value>=0 ? Form("%3.2f",value) : "-");
                 }
                 else if (key == "Label") {
-                    if (value <= lNoise) std::cout << std::right << std::setw(textWidth) << "-";
-                    else if (value <= lDecayE) std::cout << std::right << std::setw(textWidth) << "e";
-                    else if (value <= lnH) std::cout << std::right << std::setw(textWidth) << "nH";
-                    else if (value <= lnGd) std::cout << std::right << std::setw(textWidth) << "nGd";
-                    else if (value <= lGamma) std::cout << std::right << std::setw(textWidth) << "g";
-                    else if (value <= lRemnant) std::cout << std::right << std::setw(textWidth) << "=";
-                    else if (value <= lUndefined) std::cout << std::right << std::setw(textWidth) << "?";
-                    std::cout << " ";
+                    if (value <= lNoise) table << std::right << std::setw(textWidth) << "-";
+                    else if (value <= lDecayE) table << std::right << std::setw(textWidth) << "e";
+                    else if (value <= lnH) table << std::right << std::setw(textWidth) << "nH";
+                    else if (value <= lnGd) table << std::right << std::setw(textWidth) << "nGd";
+                    else if (value <= lGamma) table << std::right << std::setw(textWidth) << "g";
+                    else if (value <= lRemnant) table << std::right << std::setw(textWidth) << "=";
+                    else if (value <= lUndefined) table << std::right << std::setw(textWidth) << "?";
+                    table << " ";
                 }
                 else if (key == "TagClass") {
-                    if (value == typeE) std::cout << std::right << std::setw(textWidth) << "e";
-                    else if (value == typeN) std::cout << std::right << std::setw(textWidth) << "n";
-                    else std::cout << std::right << std::setw(textWidth) << "-";
+                    if (value == typeE) table << std::right << std::setw(textWidth) << "e";
+                    else if (value == typeN) table << std::right << std::setw(textWidth) << "n";
+                    else table << std::right << std::setw(textWidth) << "-";
                 }
                 else if (fabs(value) < 1 && value != 0) {
                     value = roundf(value*100)/100;
-                    std::cout << std::fixed << std::setprecision(2) << std::setw(textWidth) << value << " ";
+                    table << std::fixed << std::setprecision(2) << std::setw(textWidth) << value << " ";
                 }
                 else {
                     int roundedValue = (int)(value+0.5f);
-                    std::cout << std::right << std::setprecision(2) << std::setw(textWidth) << roundedValue << " ";
+                    table << std::right << std::setprecision(2) << std::setw(textWidth) << roundedValue << " ";
                 }
 
             }
-            std::cout << std::endl;
+            table << std::endl;
         }
     }
+
+    Logger::Write(cCANDIDATE, table.str());
 }
 
 
@@ -4,6 +4,7 @@
 #include <cmath>
 #include <limits>
 #include <iomanip>
+#include <iterator>
 
 #include <TTree.h>
 #include <TMath.h>
@@ -16,52 +17,50 @@
 #include <geotnkC.h>
 
 #include "Calculator.hh"
+#include "DarkRateTable.hh"
 #include "PMTHitCluster.hh"
 
 PMTHitCluster::PMTHitCluster()
-:fIsSorted(false), fHasVertex(false) {}
+:fIsSorted(false), fHasVertex(false), fHasPMTIndex(false) {}
 
-PMTHitCluster::PMTHitCluster(sktqz_common sktqz)
+PMTHitCluster::PMTHitCluster(const sktqz_common& sktqz)
 :PMTHitCluster()
 {
-    for (int iHit=0; iHit<sktqz.nqiskz; iHit++) {
-        PMTHit hit{ /*T*/ sktqz.tiskz[iHit],
-                    /*Q*/ sktqz.qiskz[iHit],
-                    /*I*/ sktqz.icabiz[iHit],
-                    /*F*/ sktqz.ihtiflz[iHit],
-                    /*S*/ sktqz.ihtiflz[iHit]&(1<<12)
-                  };
-        Append(hit);
-    }
+    AddSKTQZ(sktqz);
 }
 
-PMTHitCluster::PMTHitCluster(sktqaz_common sktqaz)
+PMTHitCluster::PMTHitCluster(const sktqaz_common& sktqaz)
 :PMTHitCluster()
 {
-    for (int iHit=0; iHit<sktqaz.nhitaz; iHit++) {
-        PMTHit hit{ /*T*/ sktqaz.taskz[iHit],
-                    /*Q*/ sktqaz.qaskz[iHit],
-                    /*I*/ sktqaz.icabaz[iHit],
-                    /*F*/ sktqaz.ihtflz[iHit],
-                    /*S*/ sktqaz.ihtflz[iHit]&(1<<12)
-                  };
-        Append(hit);
-    }
+    AddSKTQAZ(sktqaz);
 }
 
-PMTHitCluster::PMTHitCluster(TQReal* tqreal, int flag)
+PMTHitCluster::PMTHitCluster(const TQReal* tqreal, int flag)
 :PMTHitCluster()
 {
     AddTQReal(tqreal, flag);
 }
 
-void PMTHitCluster::Append(const PMTHit& hit)
+static inline bool IsValidPMTID(int i)
 {
-    int i = hit.i();
+    return (1 <= i && i <= MAXPM) || (20001 <= i && i <= 20000+MAXPMA);
+}
+
+// ID PMTs 1...MAXPM, then OD PMTs 20001...20000+MAXPMA, and 0 for invalid PMT IDs
+static const unsigned int NPMTSLOTS = MAXPM + MAXPMA + 1;
+static inline unsigned int GetPMTSlot(unsigned int i)
+{
+    if (!IsValidPMTID(i)) return 0;
+    return i < 20000 ? i : i - 20000 + MAXPM;
+}
 
+void PMTHitCluster::Append(const PMTHit& hit)
+{
     // append only hits with meaningful PMT ID
-    if ((1 <= i && i <= MAXPM) || (20001 <= i && i <= 20000+MAXPMA))
-            fElement.push_back(hit);
+    if (IsValidPMTID(hit.i())) {
+        fElement.push_back(hit);
+        fHasPMTIndex = false;
+    }
     //else
     //    std::cerr << "[PMTHitCluster] " << hit.i() << " at t=" << hit.t() << " ns is not a valid PMT cable ID!\n";
 }
@@ -82,6 +81,44 @@ void PMTHitCluster::Append(const PMTHitCluster& hitCluster, bool inGateOnly)
     }
 }
 
+void PMTHitCluster::AddSKTQZ(const sktqz_common& sktqz, Float tOffset, bool inGateOnly)
+{
+    int nHits = sktqz.nqiskz;
+    if (nHits <= 0) return;
+    fElement.reserve(fElement.size() + nHits);
+    fHasPMTIndex = false;
+
+    // read directly from the common block, skipping hits
+    // that Append(const PMTHit&) and the in-gate check would reject anyway
+    for (int iHit=0; iHit<nHits; iHit++) {
+        int i = sktqz.icabiz[iHit];
+        int f = sktqz.ihtiflz[iHit];
+        if (!IsValidPMTID(i) || (inGateOnly && !(f & (1<<1)))) continue;
+
+        fElement.emplace_back(/*T*/ sktqz.tiskz[iHit], /*Q*/ sktqz.qiskz[iHit],
+                              /*I*/ i, /*F*/ f, /*S*/ (f & (1<<12)) != 0);
+        if (tOffset) fElement.back() += tOffset;
+    }
+}
+
+void PMTHitCluster::AddSKTQAZ(const sktqaz_common& sktqaz, Float tOffset, bool inGateOnly)
+{
+    int nHits = sktqaz.nhitaz;
+    if (nHits <= 0) return;
+    fElement.reserve(fElement.size() + nHits);
+    fHasPMTIndex = false;
+
+    for (int iHit=0; iHit<nHits; iHit++) {
+        int i = sktqaz.icabaz[iHit];
+        int f = sktqaz.ihtflz[iHit];
+        if (!IsValidPMTID(i) || (inGateOnly && !(f & (1<<1)))) continue;
+
+        fElement.emplace_back(/*T*/ sktqaz.taskz[iHit], /*Q*/ sktqaz.qaskz[iHit],
+                              /*I*/ i, /*F*/ f, /*S*/ (f & (1<<12)) != 0);
+        if (tOffset) fElement.back() += tOffset;
+    }
+}
+
 bool PMTHitCluster::AppendByCoincidence(PMTHitCluster& hitCluster)
 {
     auto lastHit = GetLastHit();
@@ -91,13 +128,17 @@ bool PMTHitCluster::AppendByCoincidence(PMTHitCluster& hitCluster)
     Sort();
     hitCluster.Sort();
 
-    bool doAppend = false;
-    for (auto const& hit: hitCluster) {
-        if (doAppend) Append(hit);
-        Float hitT = hit.t();
-        if ((tSharedLowerBound < hitT) && (hitT < tSharedUpperBound) && (hit.i() == lastHit.i())) {
-            doAppend = true;
-        }
+    // look for the coincidence hit only among the hits on the same PMT
+    hitCluster.BuildPMTIndex();
+    const unsigned int* matchedHit = std::find_if(hitCluster.PMTHitsBegin(lastHit.i()), hitCluster.PMTHitsEnd(lastHit.i()),
+                                                  [&](unsigned int iHit){ Float hitT = hitCluster.fElement[iHit].t();
+                                                                          return (tSharedLowerBound < hitT) && (hitT < tSharedUpperBound); });
+    bool doAppend = matchedHit != hitCluster.PMTHitsEnd(lastHit.i());
+
+    if (doAppend) {
+        fElement.reserve(fElement.size() + hitCluster.GetSize() - *matchedHit - 1);
+        for (unsigned int iHit = *matchedHit+1; iHit < hitCluster.GetSize(); iHit++)
+            Append(hitCluster.fElement[iHit]);
     }
 
     //if (!doAppend) {
@@ -117,19 +158,22 @@ void PMTHitCluster::Clear()
     fElement.clear();
     fIsSorted = false;
     fHasVertex = false;
+    fHasPMTIndex = false;
     fVertex = TVector3();
     fMeanDirection = TVector3();
     ClearBranches();
 }
 
-void PMTHitCluster::AddTQReal(TQReal* tqreal, int flag)
+void PMTHitCluster::AddTQReal(const TQReal* tqreal, int flag)
 {
-    auto& t = tqreal->T;
-    auto& q = tqreal->Q;
-    auto& i = tqreal->cables;
+    auto const& t = tqreal->T;
+    auto const& q = tqreal->Q;
+    auto const& i = tqreal->cables;
 
-    for (unsigned int j=0; j<=t.size(); j++) {
-        Append({t[j], q[j], i[j]&0x0000FFFF, flag});
+    fElement.reserve(fElement.size() + t.size());
+
+    for (unsigned int j=0; j<t.size(); j++) {
+        Append({t[j], q[j], int(i[j]&0x0000FFFF), flag});
     }
 }
 
@@ -159,62 +203,95 @@ void PMTHitCluster::RemoveVertex()
     }
 }
 
-HitReductionResult PMTHitCluster::RemoveHits(std::function<bool(const PMTHit&)> lambda, Float tMin, Float tMax)
+std::vector<HitReductionResult> PMTHitCluster::ApplyReductions(const std::vector<HitReductionStep>& steps)
 {
-    auto cut = [=](PMTHit const & hit){ return (tMin<hit.t()) && (hit.t()<tMax) && lambda(hit); };
+    std::vector<HitReductionResult> resVec;
+    bool needsTimeOrder = false;
+    for (auto const& step: steps) {
+        HitReductionResult res = {.title=step.title, .nBeforeWhole=0, .nMatch=0, .nAfterWhole=0,
+                                  .nBeforeRange=0, .nRemoved=0, .nAfterRange=0,
+                                  .nRemovedBySignal=0, .nRemovedByNoise=0, .tMin=step.tMin, .tMax=step.tMax};
+        resVec.push_back(res);
+        needsTimeOrder |= step.needsTimeOrder;
+    }
 
-    HitReductionResult res;
-    res.title        = "";
-    res.tMin         = tMin;
-    res.tMax         = tMax;
-    res.nBeforeWhole = GetSize();
-    res.nBeforeRange = CountRange(tMin, tMax);
-    res.nMatch       = CountIf(lambda);
-    res.nRemoved     = std::count_if(fElement.begin(), fElement.end(), cut);
+    auto isEarlier = [](const PMTHit& hit1, const PMTHit& hit2) { return hit1.t() < hit2.t(); };
+    if (needsTimeOrder && !std::is_sorted(fElement.begin(), fElement.end(), isEarlier))
+        Sort();
 
-    fElement.erase(std::remove_if(fElement.begin(), fElement.end(), cut), fElement.end());
+    fIsRemoved.assign(fElement.size(), false);
+    for (unsigned int iHit=0; iHit<fElement.size(); iHit++) {
+        auto& hit = fElement[iHit];
+        for (unsigned int iStep=0; iStep<steps.size(); iStep++) {
+            auto const& step = steps[iStep];
+            auto& res = resVec[iStep];
+            bool isInRange = (step.tMin<hit.t()) && (hit.t()<step.tMax);
+            bool isMatched = step.cut(hit);
+            res.nBeforeWhole++;
+            res.nBeforeRange += isInRange;
+            res.nMatch += isMatched;
+            if (isInRange && isMatched) {
+                res.nRemoved++;
+                fIsRemoved[iHit] = true;
+                break;
+            }
+            res.nAfterWhole++;
+            res.nAfterRange += isInRange;
+        }
+    }
 
-    res.nAfterWhole = GetSize();
-    int nActuallyRemoved = res.nBeforeWhole - res.nAfterWhole;
-    assert(res.nRemoved == nActuallyRemoved);
+    EraseRemovedHits();
 
-    res.nAfterRange = CountRange(tMin, tMax);
+    return resVec;
+}
 
-    return res;
+HitReductionStep PMTHitCluster::GetBadChannelStep(Float tMin, Float tMax) const
+{
+    auto idCut = [](PMTHit& hit){ return (hit.i() > MAXPM) ||
+                                         (combad_.ibad[hit.i()-1] > 0) ||
+                                         (comdark_.dark_rate[hit.i()-1] == 0); };
+    auto odCut = [](PMTHit& hit){ return (hit.i() < 20000) || (hit.i() > 20000+MAXPMA) ||
+                                         (combada_.ibada[hit.i()-20000-1] > 0) ||
+                                         (comdark_.dark_rate_od[hit.i()-20000-1] == 0); };
+    bool isOD = !fElement.empty() && fElement.front().i() > MAXPM;
+
+    return HitReductionStep("Bad PMTs", isOD ? std::function<bool(PMTHit&)>(odCut) : idCut, tMin, tMax);
 }
 
-HitReductionResult PMTHitCluster::RemoveBadChannels(Float tMin, Float tMax)
+HitReductionStep PMTHitCluster::GetNegativeQStep(Float tMin, Float tMax)
 {
-    HitReductionResult res = {.title="Bad PMTs", .nRemoved=0, .tMin=tMin, .tMax=tMax};
+    return HitReductionStep("Q < 0", [](PMTHit& hit){ return (hit.q()<0); }, tMin, tMax);
+}
 
-    if (fElement.empty()) return res;
+HitReductionStep PMTHitCluster::GetLargeQStep(float qThreshold, Float tMin, Float tMax)
+{
+    return HitReductionStep(Form("Q > %3.2f", qThreshold), [=](PMTHit& hit){ return (hit.q()>qThreshold); }, tMin, tMax);
+}
 
-    auto idCut = [](PMTHit const & hit){ return (hit.i() > MAXPM) ||
-                                                (combad_.ibad[hit.i()-1] > 0) ||
-                                                (comdark_.dark_rate[hit.i()-1] == 0); };
-    auto odCut = [](PMTHit const & hit){ return (hit.i() < 20000) || (hit.i() > 20000+MAXPMA) ||
-                                                (combada_.ibada[hit.i()-20000-1] > 0) ||
-                                                (comdark_.dark_rate_od[hit.i()-20000-1] == 0); };
-    auto cut = (fElement.at(0).i()<=MAXPM) ? idCut : odCut;
+HitReductionStep PMTHitCluster::GetDeadtimeStep(DeadtimeCut& deadtimeCut, Float deadtime)
+{
+    return HitReductionStep(Form("%3.0f ns deadtime", deadtime), std::ref(deadtimeCut),
+                            -std::numeric_limits<Float>::infinity(), std::numeric_limits<Float>::infinity(), true);
+}
 
-    res = RemoveHits(cut, tMin, tMax);
-    res.title = "Bad PMTs";
-    
-    return res;
+HitReductionResult PMTHitCluster::RemoveHits(std::function<bool(const PMTHit&)> lambda, Float tMin, Float tMax)
+{
+    return ApplyReductions({HitReductionStep("", [&](PMTHit& hit){ return lambda(hit); }, tMin, tMax)}).front();
+}
+
+HitReductionResult PMTHitCluster::RemoveBadChannels(Float tMin, Float tMax)
+{
+    return ApplyReductions({GetBadChannelStep(tMin, tMax)}).front();
 }
 
 HitReductionResult PMTHitCluster::RemoveNegativeHits(Float tMin, Float tMax)
 {
-    HitReductionResult res = RemoveHits([](PMTHit const & hit){ return (hit.q()<0); }, tMin, tMax);
-    res.title = "Q < 0";
-    return res;
+    return ApplyReductions({GetNegativeQStep(tMin, tMax)}).front();
 }
 
 HitReductionResult PMTHitCluster::RemoveLargeQHits(float qThreshold, Float tMin, Float tMax)
 {
-    HitReductionResult res = RemoveHits([=](PMTHit const & hit){ return (hit.q()>qThreshold); }, tMin, tMax);
-    res.title = Form("Q > %3.2f", qThreshold);
-    return res;
+    return ApplyReductions({GetLargeQStep(qThreshold, tMin, tMax)}).front();
 }
 
 unsigned int PMTHitCluster::CountIf(std::function<bool(const PMTHit&)> lambda)
@@ -253,6 +330,58 @@ void PMTHitCluster::Sort()
 {
     std::sort(fElement.begin(), fElement.end(), [](const PMTHit& hit1, const PMTHit& hit2) {return hit1.t() < hit2.t();} );
     fIsSorted = true;
+    fHasPMTIndex = false;
+}
+
+void PMTHitCluster::BuildPMTIndex()
+{
+    if (fHasPMTIndex && fPMTHitIndex.size() == fElement.size()) return;
+
+    // counting sort by PMT, keeping the order of hits within each PMT
+    fPMTHitOffset.assign(NPMTSLOTS+1, 0);
+    for (auto const& hit: fElement)
+        fPMTHitOffset[GetPMTSlot(hit.i())+1]++;
+    for (unsigned int iSlot=0; iSlot<NPMTSLOTS; iSlot++)
+        fPMTHitOffset[iSlot+1] += fPMTHitOffset[iSlot];
+
+    fPMTHitIndex.resize(fElement.size());
+    std::vector<unsigned int> nFilled(fPMTHitOffset.begin(), fPMTHitOffset.end()-1);
+    for (unsigned int iHit=0; iHit<fElement.size(); iHit++)
+        fPMTHitIndex[nFilled[GetPMTSlot(fElement[iHit].i())]++] = iHit;
+
+    // hits of unsorted clusters are put in time order PMT by PMT
+    auto isEarlier = [](const PMTHit& hit1, const PMTHit& hit2) { return hit1.t() < hit2.t(); };
+    if (!std::is_sorted(fElement.begin(), fElement.end(), isEarlier)) {
+        for (unsigned int iSlot=0; iSlot<NPMTSLOTS; iSlot++) {
+            if (fPMTHitOffset[iSlot+1] - fPMTHitOffset[iSlot] < 2) continue;
+            std::stable_sort(fPMTHitIndex.begin() + fPMTHitOffset[iSlot], fPMTHitIndex.begin() + fPMTHitOffset[iSlot+1],
+                             [&](unsigned int i1, unsigned int i2){ return fElement[i1].t() < fElement[i2].t(); });
+        }
+    }
+
+    fHasPMTIndex = true;
+}
+
+const unsigned int* PMTHitCluster::PMTHitsBegin(unsigned int pmtID) const
+{
+    return fPMTHitIndex.data() + fPMTHitOffset[GetPMTSlot(pmtID)];
+}
+
+const unsigned int* PMTHitCluster::PMTHitsEnd(unsigned int pmtID) const
+{
+    return fPMTHitIndex.data() + fPMTHitOffset[GetPMTSlot(pmtID)+1];
+}
+
+void PMTHitCluster::EraseRemovedHits()
+{
+    unsigned int nKept = 0;
+    for (unsigned int iHit=0; iHit<fElement.size(); iHit++)
+        if (!fIsRemoved[iHit]) fElement[nKept++] = fElement[iHit];
+
+    if (nKept < fElement.size()) {
+        fElement.erase(fElement.begin() + nKept, fElement.end());
+        fHasPMTIndex = false;
+    }
 }
 
 void PMTHitCluster::FillTQReal(TQReal* tqreal)
@@ -270,6 +399,9 @@ void PMTHitCluster::FillTQReal(TQReal* tqreal)
     tqreal->cables.clear();
     tqreal->T.clear();
     tqreal->Q.clear();
+    tqreal->cables.reserve(fElement.size());
+    tqreal->T.reserve(fElement.size());
+    tqreal->Q.reserve(fElement.size());
 
     for (auto const& hit: fElement) {
         tqreal->cables.push_back(hit.i() + (hit.f()<<16) + (hit.s()<<28));
@@ -416,15 +548,46 @@ void PMTHitCluster::AddTimeOffset(Float tOffset)
         hit = hit + tOffset;
 }
 
+DeadtimeCut::DeadtimeCut(Float deadtime, bool doRemove)
+: fDeadtime(deadtime), fDoRemove(doRemove),
+  fLastHitT(NPMTSLOTS, std::numeric_limits<Float>::lowest()), fLastHitType(NPMTSLOTS, false),
+  fNRemovedBySignal(0) {}
+
+bool DeadtimeCut::operator()(PMTHit& hit)
+{
+    unsigned int iSlot = GetPMTSlot(hit.i());
+    Float hitT = hit.t() + hit.GetToF();
+    Float tDiff = hitT - fLastHitT[iSlot];
+    hit.SetTDiff(tDiff);
+    if (!fDoRemove || tDiff>fDeadtime) {
+        fLastHitT[iSlot] = hitT;
+        fLastHitType[iSlot] = hit.s();
+        return false;
+    }
+    // signal hit within deadtime, or noise hit due to signal within deadtime
+    if (hit.s() || fLastHitType[iSlot])
+        fNRemovedBySignal++;
+    return true;
+}
+
+void DeadtimeCut::FillResult(HitReductionResult& res) const
+{
+    res.nRemovedBySignal = fNRemovedBySignal;
+    res.nRemovedByNoise  = res.nRemoved - fNRemovedBySignal;
+}
+
 HitReductionResult PMTHitCluster::ApplyDeadtime(Float deadtime, bool doRemove)
 {
-    HitReductionResult res;
-    res.title        = Form("%3.0f ns deadtime", deadtime);
-    res.tMin         = std::numeric_limits<Float>::infinity();
-    res.tMax         = std::numeric_limits<Float>::infinity();
-    res.nBeforeWhole = GetSize();
-    res.nBeforeRange = res.nBeforeWhole;
+    // ToF is the same for all hits of a PMT, so the vertex can stay
+    DeadtimeCut deadtimeCut(deadtime, doRemove);
+    auto res = ApplyReductions({GetDeadtimeStep(deadtimeCut, deadtime)}).front();
+    deadtimeCut.FillResult(res);
+
+    return res;
+}
 
+HitReductionResult PMTHitCluster::MergeWithDeadtime(const PMTHitCluster& addedHits, Float deadtime)
+{
     TVector3 tempVertex;
     bool bHadVertex = false;
     if (fHasVertex) {
@@ -433,70 +596,25 @@ HitReductionResult PMTHitCluster::ApplyDeadtime(Float deadtime, bool doRemove)
         bHadVertex = true;
     }
 
-    std::array<Float, 20000+MAXPMA+1> HitTime;
-    std::array<bool, 20000+MAXPMA+1> HitType;
-    HitTime.fill(std::numeric_limits<Float>::lowest());
-    HitType.fill(0);
-
-    //std::array<Float, MAXPM+1>  IDHitTime;
-    //std::array<Float, MAXPMA+1> ODHitTime;
-    //IDHitTime.fill(std::numeric_limits<Float>::lowest());
-    //ODHitTime.fill(std::numeric_limits<Float>::lowest());
-
-    std::vector<PMTHit> dtCorrectedHits;
-
-    //if (!fIsSorted) Sort();
-    Sort();
-    res.nRemovedBySignal = 0;
-    for (auto& hit: fElement) {
-        int hitPMTID = hit.i();
-        Float tDiff = hit.t() - HitTime[hitPMTID];
-        hit.SetTDiff(tDiff);
-        if (!doRemove || tDiff>deadtime) {
-            //hit.SetBurstFlag(tDiff<deadtime);
-            dtCorrectedHits.push_back(hit);
-            HitTime[hitPMTID] = hit.t();
-            HitType[hitPMTID] = hit.s();
-        }
-        else if (hit.s()) {
-            //std::cout << "Removing signal hit within deadtime " << deadtime << " ns: "; hit.Dump();
-            res.nRemovedBySignal++;
-        }
-        else if (HitType[hitPMTID]) {
-            //std::cout << "Removing noise hit due to signal within deadtime " << deadtime << " ns: "; hit.Dump();
-            res.nRemovedBySignal++;
-        }
-        //else {
-        //    HitTime[hitPMTID] = hit.t();
-        //    HitType[hitPMTID] = hit.s();
-        //    std::cout << "Removing noise hit due to noise within deadtime " << deadtime << " ns: "; hit.Dump();
-        //}
-    }
-
-    res.nAfterRange     = dtCorrectedHits.size();
-    res.nAfterWhole     = res.nAfterRange;
-    res.nRemoved        = res.nBeforeRange - res.nAfterRange;
-    res.nMatch          = res.nRemoved;
-    res.nRemovedByNoise = res.nRemoved - res.nRemovedBySignal;
+    auto isEarlier = [](const PMTHit& hit1, const PMTHit& hit2) { return hit1.t() < hit2.t(); };
+    if (!std::is_sorted(fElement.begin(), fElement.end(), isEarlier))
+        Sort();
+    assert(std::is_sorted(addedHits.fElement.begin(), addedHits.fElement.end(), isEarlier));
+
+    // hits in this cluster come first at equal times
+    std::vector<PMTHit> mergedHits;
+    mergedHits.reserve(GetSize() + addedHits.GetSize());
+    std::merge(fElement.begin(), fElement.end(), addedHits.fElement.begin(), addedHits.fElement.end(),
+               std::back_inserter(mergedHits), isEarlier);
+    fElement.swap(mergedHits);
+    fIsSorted = true;
+    fHasPMTIndex = false;
 
-    fElement = dtCorrectedHits;
+    auto res = ApplyDeadtime(deadtime);
 
     if (bHadVertex)
         SetVertex(tempVertex);
 
-    //if (doRemove/*&& nRemovedHits*/) {
-        //std::cout << Form("[ApplyDeadtime]      Total %6d -> %6d hits: "
-        //                  "removed %6d hits in time range [  -inf,    inf] usec (%d due to signal)\n",
-        //                  allSize, GetSize(), nRemovedHits, nRemovedBySignal, deadtime);
-    //    std::cout << std::setw(21) << std::left << Form("[ %4.0f ns deadtime ] ", deadtime);
-    //    std::cout << Form("Removed %6d hits in time range [  -inf,    inf] usec: Total %6d -> %6d hits\n",
-    //                      nRemovedHits, allSize, GetSize())//;
-
-        //std::cout << "[ApplyDeadtime]      Removed " << nRemovedHits << Form(" ( %d due to signal ) ", nRemovedBySignal)
-        //          << "hits for PMT deadtime " << deadtime << " ns\n";
-    //}
-
-    //return std::array<unsigned int,2>({nRemovedBySignal, nRemovedByNoise});
     return res;
 }
 
@@ -683,10 +801,11 @@ unsigned int PMTHitCluster::GetNBurst()
 
 unsigned int PMTHitCluster::GetNNoisyPMT()
 {
+    DarkRateTable::Update();
+
     unsigned int nNoisyPMT = 0;
-    for (auto const& hit: fElement) {
-        if (comdark_.dark_rate[hit.i()-1] > comdark_.dark_ave) nNoisyPMT++;
-    }
+    for (auto const& hit: fElement)
+        nNoisyPMT += DarkRateTable::IsNoisy(hit.i());
     return nNoisyPMT;
 }
 
@@ -702,25 +821,27 @@ float PMTHitCluster::GetBurstRatio()
 
 float PMTHitCluster::GetBurstSignificance(float tBurstWindow)
 {
+    DarkRateTable::Update();
+
     int obs = GetNBurst();
     float exp = 0;
-    float flatDarkRatio = 0.5;
-    for (auto const& hit: fElement) {
-        exp += comdark_.dark_rate[hit.i()-1] * flatDarkRatio * tBurstWindow * 1e-6;
-    }
+    for (auto const& hit: fElement)
+        exp += DarkRateTable::GetBurstRate(hit.i());
+    exp *= tBurstWindow;
+
     return (obs-exp)/sqrt(exp);
 }
 
 float PMTHitCluster::GetDarkLikelihood()
 {
-    float darkLLH = 1;
-    for (auto const& hit: fElement) {
-        float ratio = comdark_.dark_rate[hit.i()-1] / comdark_.dark_ave;
-        darkLLH *= ratio;
-        //if (ratio>0) darkLLH *= ratio;
-    }
+    DarkRateTable::Update();
+
+    // sum of log ratios instead of log of product, to avoid under/overflow
+    float logDarkLLH = 0;
+    for (auto const& hit: fElement)
+        logDarkLLH += DarkRateTable::GetLogRatio(hit.i());
 
-    return Sigmoid(std::log(darkLLH));
+    return Sigmoid(logDarkLLH);
 }
 
 float PMTHitCluster::GetNoisyPMTRatio()
@@ -753,11 +874,7 @@ PMTHitCluster PMTHitCluster::Slice(std::function<float(const PMTHit&)> lambda, f
 
 void PMTHitCluster::ApplyCut(std::function<float(const PMTHit&)> lambda, float min, float max)
 {
-    for (unsigned int iHit=0; iHit<GetSize(); iHit++) {
-        auto& hit = fElement.at(iHit);
-        if (min > lambda(hit) || lambda(hit) > max)
-            fElement.erase(fElement.begin()+iHit);
-    }
+    ApplyReductions({HitReductionStep("", [&](PMTHit& hit){ float value = lambda(hit); return min > value || value > max; })});
 }
 
 void PMTHitCluster::MakeBranches()
@@ -25,25 +25,91 @@ typedef struct HitReductionResult {
     Float tMin, tMax;
 } HitReductionResult;
 
+/******************************************
+* @brief One step of PMTHitCluster::ApplyReductions.
+*******************************************/
+struct HitReductionStep
+{
+    HitReductionStep(std::string t, std::function<bool(PMTHit&)> c,
+                     Float min=-std::numeric_limits<Float>::infinity(),
+                     Float max=std::numeric_limits<Float>::infinity(), bool timeOrder=false)
+    : title(t), cut(c), tMin(min), tMax(max), needsTimeOrder(timeOrder) {}
+
+    std::string title;
+    std::function<bool(PMTHit&)> cut; ///< Returns \c true for hits to remove. Stateful cuts see hits one by one.
+    Float tMin, tMax;                 ///< Hits are removed only within (tMin, tMax)
+    bool needsTimeOrder;              ///< \c true if the cut needs time-sorted hits
+};
+
+/******************************************
+* @brief Stateful cut that applies PMT deadtime.
+*
+* @details A hit is removed if it comes within
+* the deadtime from the last kept hit of the same PMT.
+* Hits must be given in time order, and TDiff of
+* each hit is set. Times without ToF-subtraction
+* are used.
+*******************************************/
+class DeadtimeCut
+{
+    public:
+        DeadtimeCut(Float deadtime, bool doRemove=true);
+
+        bool operator()(PMTHit& hit);
+
+        /** Fills the numbers of hits removed due to signal and noise. */
+        void FillResult(HitReductionResult& res) const;
+
+    private:
+        Float fDeadtime;
+        bool fDoRemove;
+        std::vector<Float> fLastHitT;
+        std::vector<bool> fLastHitType;
+        unsigned int fNRemovedBySignal;
+};
+
 class PMTHitCluster : public Cluster<PMTHit>, public TreeOut
 {
     public:
         PMTHitCluster();
-        PMTHitCluster(sktqz_common sktqz);
-        PMTHitCluster(sktqaz_common sktqaz);
-        PMTHitCluster(TQReal* tqreal, int flag=2/* default: in-gate */);
+        explicit PMTHitCluster(const sktqz_common& sktqz);
+        explicit PMTHitCluster(const sktqaz_common& sktqaz);
+        explicit PMTHitCluster(const TQReal* tqreal, int flag=2/* default: in-gate */);
 
         void Append(const PMTHit& hit);
         void Append(const PMTHitCluster& hitCluster, bool inGateOnly=false);
+        // same as Append(PMTHitCluster(sktqz)+tOffset, inGateOnly), without temporary copies
+        void AddSKTQZ(const sktqz_common& sktqz, Float tOffset=0, bool inGateOnly=false);
+        void AddSKTQAZ(const sktqaz_common& sktqaz, Float tOffset=0, bool inGateOnly=false);
         bool AppendByCoincidence(PMTHitCluster& hitCluster);
         void Clear();
-        void AddTQReal(TQReal* tqreal, int flag=2/* default: in-gate */);
+        void AddTQReal(const TQReal* tqreal, int flag=2/* default: in-gate */);
 
         void SetVertex(const TVector3& inVertex);
         inline const TVector3& GetVertex() const { return fVertex; }
         bool HasVertex() { return fHasVertex; }
         void RemoveVertex();
 
+        /**
+         * @brief Removes hits with a chain of cuts in a single pass.
+         * @details Each hit goes through the steps in order until a step removes it,
+         * so each step sees the hits kept by the previous steps, as if
+         * the steps were applied one by one.
+         * @param steps Reduction steps.
+         * @return Hit reduction results of each step.
+         */
+        std::vector<HitReductionResult> ApplyReductions(const std::vector<HitReductionStep>& steps);
+
+        HitReductionStep GetBadChannelStep(Float tMin=-std::numeric_limits<Float>::infinity(),
+                                           Float tMax=std::numeric_limits<Float>::infinity()) const;
+        static HitReductionStep GetNegativeQStep(Float tMin=-std::numeric_limits<Float>::infinity(),
+                                                 Float tMax=std::numeric_limits<Float>::infinity());
+        static HitReductionStep GetLargeQStep(float qThreshold=10,
+                                              Float tMin=-std::numeric_limits<Float>::infinity(),
+                                              Float tMax=std::numeric_limits<Float>::infinity());
+        /** The step keeps a reference to \c deadtimeCut, to read its result after PMTHitCluster::ApplyReductions. */
+        static HitReductionStep GetDeadtimeStep(DeadtimeCut& deadtimeCut, Float deadtime);
+
         HitReductionResult RemoveHits(std::function<bool(const PMTHit&)> lambda, 
                                       Float tMin=-std::numeric_limits<Float>::infinity(), 
                                       Float tMax=std::numeric_limits<Float>::infinity());
@@ -86,8 +152,22 @@ class PMTHitCluster : public Cluster<PMTHit>, public TreeOut
 
         inline const TVector3& GetMeanDirection() const { return fMeanDirection; }
 
+        /**
+         * @brief Builds the per-PMT hit index, unless it is already built.
+         * @details Hit indices are grouped by PMT with a counting sort
+         * (compressed sparse rows), in time order within each PMT.
+         * The index is dropped when hits are added, removed, or sorted.
+         */
+        void BuildPMTIndex();
+        bool HasPMTIndex() const { return fHasPMTIndex; }
+        /** Indices of the hits on PMT \c pmtID in time order, valid after PMTHitCluster::BuildPMTIndex. */
+        const unsigned int* PMTHitsBegin(unsigned int pmtID) const;
+        const unsigned int* PMTHitsEnd(unsigned int pmtID) const;
+
         void AddTimeOffset(Float tOffset);
         HitReductionResult ApplyDeadtime(Float deadtime, bool doRemove=true);
+        // same as Append(addedHits) followed by ApplyDeadtime(deadtime), as a single merge of time-sorted hits
+        HitReductionResult MergeWithDeadtime(const PMTHitCluster& addedHits, Float deadtime);
 
         template<typename T>
         float Find(std::function<T(const PMTHit&)> projFunc,
@@ -137,9 +217,15 @@ class PMTHitCluster : public Cluster<PMTHit>, public TreeOut
         void FillTree(bool asResidual=false);
 
     private:
-        bool fIsSorted, fHasVertex;
+        bool fIsSorted, fHasVertex, fHasPMTIndex;
         TVector3 fVertex, fMeanDirection;
 
+        // per-PMT hit index: hits of PMT slot s are fPMTHitIndex[fPMTHitOffset[s]...fPMTHitOffset[s+1]-1]
+        std::vector<unsigned int> fPMTHitOffset, fPMTHitIndex;
+        std::vector<bool> fIsRemoved;
+
+        void EraseRemovedHits();
+
         std::vector<Float> fT, fToF, fDT;
         std::vector<float> fQ;
         std::vector<bool> fI, fS, fB, fTag;
@@ -1,4 +1,5 @@
 #include <iomanip>
+#include <sstream>
 
 #include <neworkC.h>
 
@@ -8,12 +9,12 @@
 #include "ParticleCluster.hh"
 #include "Printer.hh"
 
-ParticleCluster::ParticleCluster(vcwork_common primaryCommon, secndprt_common secondaryCommon)
+ParticleCluster::ParticleCluster(const vcwork_common& primaryCommon, const secndprt_common& secondaryCommon)
 {
     ReadCommonBlock(primaryCommon, secondaryCommon);
 }
 
-void ParticleCluster::ReadCommonBlock(vcwork_common primaryCommon, secndprt_common secondaryCommon)
+void ParticleCluster::ReadCommonBlock(const vcwork_common& primaryCommon, const secndprt_common& secondaryCommon)
 {
     Clear();
 
@@ -80,18 +81,22 @@ void ParticleCluster::Sort()
 
 void ParticleCluster::DumpAllElements() const
 {
-    Printer msg;
+    Printer msg("", pDEFAULT, cMC);
+    if (!msg.IsEnabled()) return;
 
     if (nework_.modene) {
         msg.PrintBlock("NEUT MC", pEVENT);
-        std::cout << "\033[4m Neutrino Type      Interaction  Momentum (GeV/c)\033[0m\n ";
-        std::cout << std::right << std::setw(13) << GetParticleName(nework_.ipne[0]) << " ";
-        std::cout << std::right << std::setw(16) << GetNEUTModeName(nework_.modene) << " ";
-        std::cout << std::right << std::setw(14) << std::fixed << std::setprecision(2) << TVector3(nework_.pne[0]).Mag() << "\n\n";
+        std::ostringstream neutTable;
+        neutTable << "\033[4m Neutrino Type      Interaction  Momentum (GeV/c)\033[0m\n ";
+        neutTable << std::right << std::setw(13) << GetParticleName(nework_.ipne[0]) << " ";
+        neutTable << std::right << std::setw(16) << GetNEUTModeName(nework_.modene) << " ";
+        neutTable << std::right << std::setw(14) << std::fixed << std::setprecision(2) << TVector3(nework_.pne[0]).Mag() << "\n\n";
+        Logger::Write(cMC, neutTable.str());
     }
 
     msg.PrintBlock("MC Particles", pEVENT);
-    std::cout << "\033[4m No.   Particle Time (us) Interaction  Parent(Index) KE (MeV) \033[0m" << std::endl;
+    std::ostringstream table;
+    table << "\033[4m No.   Particle Time (us) Interaction  Parent(Index) KE (MeV) \033[0m" << std::endl;
 
     for (unsigned int iParticle = 0; iParticle < fElement.size(); iParticle++) {
         auto& particle = fElement.at(iParticle);
@@ -102,19 +107,21 @@ void ParticleCluster::DumpAllElements() const
 
         //auto mom = particle.Momentum().Mag();
         auto ke = particle.Energy();
-        std::cout << std::right << std::setw(3) << iParticle+1 << "  ";
-        std::cout << std::right << std::setw(10) << particle.GetName() << " ";
+        table << std::right << std::setw(3) << iParticle+1 << "  ";
+        table << std::right << std::setw(10) << particle.GetName() << " ";
         if (particle.Time()< 10)
-        std::cout << " " << std::right << std::setw(8) << std::fixed << std::setprecision(2) << particle.Time() << " ";
+        table << " " << std::right << std::setw(8) << std::fixed << std::setprecision(2) << particle.Time() << " ";
         else
-        std::cout << std::right << std::setw(8) << (int)(particle.Time()+0.5f) << "  ";
-        std::cout << std::right << std::setw(11) << particle.GetIntName() << " ";
-        std::cout << std::right << std::setw(14) << (parentName+parentIndex) << " ";
+        table << std::right << std::setw(8) << (int)(particle.Time()+0.5f) << "  ";
+        table << std::right << std::setw(11) << particle.GetIntName() << " ";
+        table << std::right << std::setw(14) << (parentName+parentIndex) << " ";
         if (ke<10)
-            std::cout << std::right << std::setw(8) << std::setprecision(1) << ke << "\n";
+            table << std::right << std::setw(8) << std::setprecision(1) << ke << "\n";
         else
-            std::cout << std::right << std::setw(6) << std::fixed << (int)(ke+0.5f) << "\n";
+            table << std::right << std::setw(6) << std::fixed << (int)(ke+0.5f) << "\n";
     }
+
+    Logger::Write(cMC, table.str());
 }
 
 void ParticleCluster::MakeBranches()
@@ -12,9 +12,9 @@ class ParticleCluster : public Cluster<Particle>, public TreeOut
 {
     public:
         ParticleCluster() {}
-        ParticleCluster(vcwork_common primary, secndprt_common secondary);
+        ParticleCluster(const vcwork_common& primary, const secndprt_common& secondary);
 
-        void ReadCommonBlock(vcwork_common primary, secndprt_common secondary);
+        void ReadCommonBlock(const vcwork_common& primary, const secndprt_common& secondary);
 
         void SetT0(float t0);
 
@@ -1,5 +1,6 @@
 #include <algorithm>
 #include <iomanip>
+#include <sstream>
 
 #include "Calculator.hh"
 #include "Printer.hh"
@@ -73,9 +74,12 @@ void TaggableCluster::Sort()
 
 void TaggableCluster::DumpAllElements() const
 {
-    Printer msg;
+    Printer msg("", pDEFAULT, cMC);
+    if (!msg.IsEnabled()) return;
+
     msg.PrintBlock("MC Taggables", pEVENT);
-    std::cout << "\033[4m No. Type     Time (us) Dist (cm) DWall (cm) Energy (MeV) Early Delayed TaggedAs\033[0m" << std::endl;
+    std::ostringstream table;
+    table << "\033[4m No. Type     Time (us) Dist (cm) DWall (cm) Energy (MeV) Early Delayed TaggedAs\033[0m" << std::endl;
 
     for (unsigned int iTaggable = 0; iTaggable < fElement.size(); iTaggable++) {
         auto& taggable = fElement.at(iTaggable);
@@ -84,22 +88,24 @@ void TaggableCluster::DumpAllElements() const
         auto earlyIndex = taggable.GetCandidateIndex("Early")+1;
         auto delayedIndex = taggable.GetCandidateIndex("Delayed")+1;
         auto taggedType = taggable.TaggedType();
-        std::cout << std::right << std::setw(3) << iTaggable+1 << "  ";
-        std::cout << std::right << std::setw(8) << (taggable.Type() == typeE ? "mu-e" : (taggable.Type() == typeN ? "nCapture" : "gamma")) << " ";
+        table << std::right << std::setw(3) << iTaggable+1 << "  ";
+        table << std::right << std::setw(8) << (taggable.Type() == typeE ? "mu-e" : (taggable.Type() == typeN ? "nCapture" : "gamma")) << " ";
         if (time<10)
-        std::cout << " " << std::right << std::setw(8) << std::fixed << std::setprecision(2) << time << " ";
+        table << " " << std::right << std::setw(8) << std::fixed << std::setprecision(2) << time << " ";
         else
-        std::cout << std::right << std::setw(6) << std::fixed << (int)(time+0.5f) << "    ";
-        std::cout << std::right << std::setw(8) << (vertex.Mag()<1e-3 ? -1 : (int)((taggable.Vertex()-fPromptVertex).Mag())) << " ";
-        std::cout << std::right << std::setw(10) << (int)(GetDWall(vertex)) << "  ";
-        std::cout << std::right << std::setw(11) << std::setprecision(2) << taggable.Energy() << "  ";
-        std::cout << std::right << std::setw(5) << (earlyIndex ? std::to_string(earlyIndex) : "-") << " ";
-        std::cout << std::right << std::setw(7) << (delayedIndex ? std::to_string(delayedIndex) : "-") << " ";
-        std::cout << std::right << std::setw(8) << (taggedType==typeMissed ? "-" : (
+        table << std::right << std::setw(6) << std::fixed << (int)(time+0.5f) << "    ";
+        table << std::right << std::setw(8) << (vertex.Mag()<1e-3 ? -1 : (int)((taggable.Vertex()-fPromptVertex).Mag())) << " ";
+        table << std::right << std::setw(10) << (int)(GetDWall(vertex)) << "  ";
+        table << std::right << std::setw(11) << std::setprecision(2) << taggable.Energy() << "  ";
+        table << std::right << std::setw(5) << (earlyIndex ? std::to_string(earlyIndex) : "-") << " ";
+        table << std::right << std::setw(7) << (delayedIndex ? std::to_string(delayedIndex) : "-") << " ";
+        table << std::right << std::setw(8) << (taggedType==typeMissed ? "-" : (
                                                     taggedType==typeE ?      "e" : (
                                                     taggedType==typeN?       "n" :
                                                     /* else */               "e/n"))) << "\n";
     }
+
+    Logger::Write(cMC, table.str());
 }
 
 void TaggableCluster::MakeBranches()